@@ -0,0 +1,195 @@
+#include "analyzer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Compile-time mirror of a lambda frame: slot i holds names[i].
+struct Scope {
+    std::vector<SymbolId> names;
+    Scope* up = nullptr;
+};
+
+bool IsSymbol(Object* obj, SymbolId id) {
+    return Is<Symbol>(obj) && As<Symbol>(obj)->GetId() == id;
+}
+
+void Declare(Scope* scope, SymbolId id) {
+    auto& names = scope->names;
+    if (std::find(names.begin(), names.end(), id) == names.end()) {
+        names.push_back(id);
+    }
+}
+
+// Variable named by a symbol: a frame slot if some enclosing lambda binds
+// it, the global otherwise. Assignment targets keep core builtin names as
+// globals, which the builtin then shadows.
+Object* ResolveTarget(Symbol* symbol, Scope* scope, Context& context) {
+    SymbolId id = symbol->GetId();
+    auto& registry = FunctionRegistry::Instance();
+    if (registry.HasFunction(id) && !registry.IsLibraryFunction(id)) {
+        return symbol;
+    }
+    for (size_t depth = 0; scope != nullptr; scope = scope->up, ++depth) {
+        auto& names = scope->names;
+        for (size_t slot = names.size(); slot-- > 0;) {
+            if (names[slot] == id) {
+                return context.GetHeap()->Make<LocalVariable>(id, depth, slot);
+            }
+        }
+    }
+    return symbol;
+}
+
+// Core builtins take precedence over variables, so their names refer to the
+// builtin itself, which is put in the tree instead of the symbol. Library
+// names resolve like variables; a global one falls back to the builtin at
+// run time.
+Object* Resolve(Symbol* symbol, Scope* scope, Context& context) {
+    SymbolId id = symbol->GetId();
+    auto& registry = FunctionRegistry::Instance();
+    if (registry.HasFunction(id) && !registry.IsLibraryFunction(id)) {
+        return registry.GetFunction(id);
+    }
+    return ResolveTarget(symbol, scope, context);
+}
+
+// Finds the defines executed directly in the frame of the lambda being
+// analyzed, i.e. anywhere in its body except quoted data and nested lambdas.
+void CollectDefines(Object* form, Scope* scope) {
+    if (!Is<Cell>(form)) {
+        return;
+    }
+    Cell* cell = As<Cell>(form);
+    Object* head = cell->GetFirst();
+    if (IsSymbol(head, SymbolTable::kQuote) || IsSymbol(head, SymbolTable::kLambda)) {
+        return;
+    }
+    if (IsSymbol(head, SymbolTable::kDefine) && Is<Cell>(cell->GetSecond())) {
+        Object* target = As<Cell>(cell->GetSecond())->GetFirst();
+        bool is_function = Is<Cell>(target);
+        if (is_function) {
+            target = As<Cell>(target)->GetFirst();
+        }
+        if (Is<Symbol>(target)) {
+            Declare(scope, As<Symbol>(target)->GetId());
+        }
+        if (is_function) {
+            return;
+        }
+    }
+    while (true) {
+        CollectDefines(cell->GetFirst(), scope);
+        if (!Is<Cell>(cell->GetSecond())) {
+            CollectDefines(cell->GetSecond(), scope);
+            return;
+        }
+        cell = As<Cell>(cell->GetSecond());
+    }
+}
+
+Object* AnalyzeForm(Object* form, Scope* scope, Context& context);
+
+// Analyzes every element of a (possibly improper) list in place.
+void AnalyzeElements(Object* list, Scope* scope, Context& context) {
+    while (Is<Cell>(list)) {
+        Cell* cell = As<Cell>(list);
+        cell->SetFirst(AnalyzeForm(cell->GetFirst(), scope, context));
+        list = cell->GetSecond();
+        if (list != nullptr && !Is<Cell>(list)) {
+            cell->SetSecond(AnalyzeForm(list, scope, context));
+        }
+    }
+}
+
+void AnalyzeLambda(Cell* form, Scope* scope, Context& context) {
+    if (!Is<Cell>(form->GetSecond())) {
+        return;
+    }
+    Cell* rest = As<Cell>(form->GetSecond());
+    Scope inner;
+    inner.up = scope;
+    Object* params = rest->GetFirst();
+    while (Is<Cell>(params)) {
+        Object* param = As<Cell>(params)->GetFirst();
+        if (Is<Symbol>(param)) {
+            inner.names.push_back(As<Symbol>(param)->GetId());
+        }
+        params = As<Cell>(params)->GetSecond();
+        if (Is<Symbol>(params)) {
+            inner.names.push_back(As<Symbol>(params)->GetId());
+        }
+    }
+    CollectDefines(rest->GetSecond(), &inner);
+    AnalyzeElements(rest->GetSecond(), &inner, context);
+    form->SetFirst(context.GetHeap()->Make<LambdaBuilderFunction>(inner.names.size()));
+}
+
+void AnalyzeDefine(Cell* form, Scope* scope, Context& context) {
+    if (!Is<Cell>(form->GetSecond())) {
+        return;
+    }
+    Heap* heap = context.GetHeap();
+    Cell* rest = As<Cell>(form->GetSecond());
+    if (Is<Cell>(rest->GetFirst())) {
+        Cell* signature = As<Cell>(rest->GetFirst());
+        Cell* lambda_rest = heap->Make<Cell>();
+        lambda_rest->SetFirst(signature->GetSecond());
+        lambda_rest->SetSecond(rest->GetSecond());
+        Cell* lambda = heap->Make<Cell>();
+        lambda->SetFirst(heap->InternSymbol(SymbolTable::kLambda));
+        lambda->SetSecond(lambda_rest);
+        Cell* value = heap->Make<Cell>();
+        value->SetFirst(lambda);
+        rest->SetFirst(signature->GetFirst());
+        rest->SetSecond(value);
+    }
+    if (Is<Symbol>(rest->GetFirst())) {
+        rest->SetFirst(ResolveTarget(As<Symbol>(rest->GetFirst()), scope, context));
+    }
+    AnalyzeElements(rest->GetSecond(), scope, context);
+}
+
+// set!, set-car! and set-cdr! take a variable rather than a value first.
+void AnalyzeAssignment(Cell* form, Scope* scope, Context& context) {
+    if (!Is<Cell>(form->GetSecond())) {
+        return;
+    }
+    Cell* rest = As<Cell>(form->GetSecond());
+    if (Is<Symbol>(rest->GetFirst())) {
+        rest->SetFirst(ResolveTarget(As<Symbol>(rest->GetFirst()), scope, context));
+    }
+    AnalyzeElements(rest->GetSecond(), scope, context);
+}
+
+Object* AnalyzeForm(Object* form, Scope* scope, Context& context) {
+    if (Is<Symbol>(form)) {
+        return Resolve(As<Symbol>(form), scope, context);
+    }
+    if (!Is<Cell>(form)) {
+        return form;
+    }
+    Cell* cell = As<Cell>(form);
+    Object* head = cell->GetFirst();
+    if (IsSymbol(head, SymbolTable::kQuote)) {
+        return form;
+    }
+    if (IsSymbol(head, SymbolTable::kLambda)) {
+        AnalyzeLambda(cell, scope, context);
+    } else if (IsSymbol(head, SymbolTable::kDefine)) {
+        AnalyzeDefine(cell, scope, context);
+    } else if (IsSymbol(head, SymbolTable::kSet) || IsSymbol(head, SymbolTable::kSetCar) ||
+               IsSymbol(head, SymbolTable::kSetCdr)) {
+        AnalyzeAssignment(cell, scope, context);
+    } else {
+        AnalyzeElements(cell, scope, context);
+    }
+    return form;
+}
+
+}  // namespace
+
+Object* Analyze(Object* form, Context& context) {
+    return AnalyzeForm(form, nullptr, context);
+}
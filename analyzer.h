@@ -0,0 +1,11 @@
+#pragma once
+
+#include "object.h"
+
+// Resolves variable references in a freshly read form before it is
+// evaluated. Lambda parameters and internal defines become LocalVariable
+// nodes addressing a (depth, slot) pair in the frame chain, lambda heads are
+// replaced by builders that know their frame size, and (define (f ...) ...)
+// is rewritten into (define f (lambda (...) ...)). Everything else is left
+// as a Symbol and looked up among builtins and globals at run time.
+Object* Analyze(Object* form, Context& context);
@@ -0,0 +1,55 @@
+// Throughput of independent interpreters, one per thread, for 1, 2, 4, ...
+// threads up to the number of cores. Each thread runs the same fixed amount
+// of work, so with no shared state on the evaluation path the wall time
+// stays flat and the speedup grows linearly.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. interpreter_threads_bench.cpp $(ls ../*.cpp) -o interpreter_threads_bench
+
+#include "scheme.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kRequestsPerThread = 200;
+
+void RunWorkload() {
+    Interpreter interpreter;
+    interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    interpreter.Run("(define (make n) (if (= n 0) '() (cons n (make (- n 1)))))");
+    for (int i = 0; i < kRequestsPerThread; ++i) {
+        interpreter.Run("(fib 15)");
+        interpreter.Run("(list-tail (make 200) 150)");
+    }
+}
+
+double Measure(unsigned threads) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(RunWorkload);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+}  // namespace
+
+int main() {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    // Warm up the shared registry and symbol table.
+    RunWorkload();
+    double single = Measure(1);
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        double seconds = Measure(threads);
+        std::printf("%3u threads  %7.3f s  %8.0f requests/s  speedup %5.2f\n", threads, seconds,
+                    2.0 * kRequestsPerThread * threads / seconds, single * threads / seconds);
+    }
+}
@@ -0,0 +1,259 @@
+// Lexer throughput on two inputs of a few megabytes: code-like source of
+// short tokens, and a quoted data literal of long symbols, long integers and
+// deep indentation. Each is lexed by the original character-at-a-time
+// stream tokenizer, through the istream Tokenizer adapter, and once per scan
+// level the CPU supports.
+//
+//   g++ -std=c++17 -O2 -I.. lexer_bench.cpp ../tokenizer.cpp ../char_scan.cpp ../error.cpp -o lexer_bench
+
+#include "char_scan.h"
+#include "error.h"
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+
+namespace {
+
+constexpr int kRepeats = 5;
+
+// The tokenizer as it was before the Lexer, reading the stream through
+// peek() and get() and classifying characters with hash set lookups.
+class BaselineTokenizer {
+public:
+    explicit BaselineTokenizer(std::istream* in) : in_(in) {
+        Next();
+    }
+
+    bool IsEnd() const {
+        return is_end_;
+    }
+
+    void Next() {
+        while (!IsNowEnd() && std::isspace(Peek())) {
+            Get();
+        }
+        if (IsNowEnd()) {
+            is_end_ = true;
+            return;
+        }
+        char c = Peek();
+        if (c == '(') {
+            current_token_ = BracketToken::OPEN;
+            Get();
+            return;
+        }
+        if (c == ')') {
+            current_token_ = BracketToken::CLOSE;
+            Get();
+            return;
+        }
+        if (c == '\'') {
+            current_token_ = QuoteToken();
+            Get();
+            return;
+        }
+        if (c == '.') {
+            current_token_ = DotToken();
+            Get();
+            return;
+        }
+        if (std::isdigit(c)) {
+            current_token_ = ConstantToken{GetNumber()};
+            return;
+        }
+        if (c == '+' || c == '-') {
+            Get();
+            int64_t x = GetNumber();
+            if (x == -1) {
+                current_token_ = SymbolToken{c + GetString()};
+            } else {
+                current_token_ = ConstantToken{c == '+' ? x : -x};
+            }
+            return;
+        }
+        current_token_ = SymbolToken{GetString()};
+    }
+
+private:
+    static bool IsSymbol(char c) {
+        static std::unordered_set<char> symbols = {'<', '=', '>', '*', '/',
+                                                   '#', '?', '!', '-', '+'};
+        return std::isalnum(c) || symbols.count(c);
+    }
+
+    static bool IsInSyntax(char c) {
+        static std::unordered_set<char> other_symbols = {'.', '\'', '(', ')'};
+        return other_symbols.count(c) || IsSymbol(c) || std::isspace(c);
+    }
+
+    int64_t GetNumber() {
+        if (IsNowEnd() || !std::isdigit(Peek())) {
+            return -1;
+        }
+        int64_t result = 0;
+        while (!IsNowEnd() && std::isdigit(Peek())) {
+            result = result * 10 + (Get() - '0');
+        }
+        return result;
+    }
+
+    std::string GetString() {
+        std::string result;
+        while (!IsNowEnd()) {
+            SyntaxAssert(IsInSyntax(Peek()));
+            if (!IsSymbol(Peek())) {
+                break;
+            }
+            result.push_back(Get());
+        }
+        return result;
+    }
+
+    bool IsNowEnd() {
+        return in_->peek() == std::char_traits<char>::eof();
+    }
+
+    char Peek() {
+        return in_->peek();
+    }
+
+    char Get() {
+        SyntaxAssert(IsInSyntax(Peek()));
+        return in_->get();
+    }
+
+    std::istream* in_;
+    std::optional<Token> current_token_;
+    bool is_end_ = false;
+};
+
+// A quoted data list of symbols, integers of various lengths and nested
+// lists, with indentation typical of hand-written code.
+std::string MakeSource(size_t size) {
+    std::string res = "'(";
+    uint64_t seed = 1;
+    while (res.size() < size) {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        switch ((seed >> 33) % 4) {
+            case 0:
+                res += "\n    (define-record-type point-of-interest? ";
+                break;
+            case 1:
+                res += std::to_string(seed >> 20) + " ";
+                break;
+            case 2:
+                res += std::to_string((seed >> 40) % 100) + " -17 ";
+                break;
+            default:
+                res += "(list->vector lst) ";
+                break;
+        }
+    }
+    return res + ")";
+}
+
+// A quoted table of records as data files hold them: long hyphenated names,
+// integers of 15 to 18 digits, and nesting indented by four spaces a level,
+// so that runs are mostly longer than the wide scanners' prefix.
+std::string MakeDataLiteral(size_t size) {
+    static const char* words[] = {"measurement", "calibrated", "temperature", "coefficient",
+                                  "northern-hemisphere", "station", "interpolated", "reading"};
+    std::string res = "'(";
+    uint64_t seed = 7;
+    int depth = 1;
+    while (res.size() < size) {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        switch ((seed >> 33) % 5) {
+            case 0:
+                if (depth < 12) {
+                    res += "\n" + std::string(4 * depth, ' ') + "(";
+                    ++depth;
+                }
+                break;
+            case 1:
+                if (depth > 1) {
+                    res += ")";
+                    --depth;
+                }
+                break;
+            case 2:
+                res += std::to_string(100000000000000 + (seed >> 14) % 900000000000000000) + " ";
+                break;
+            default:
+                for (int i = 0; i < 3; ++i) {
+                    res += words[(seed >> (40 + 3 * i)) % 8];
+                    res += i < 2 ? "-" : " ";
+                }
+                break;
+        }
+    }
+    return res + std::string(depth, ')');
+}
+
+template <class F>
+void Measure(const char* name, size_t size, F lex) {
+    double best = 1e9;
+    size_t tokens = 0;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        tokens = lex();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    std::printf("%-10s %8.1f MB/s  (%zu tokens)\n", name, size / best / 1e6, tokens);
+}
+
+void Run(const char* title, const std::string& source) {
+    std::printf("%s, %.1f MB\n", title, source.size() / 1e6);
+
+    Measure("baseline", source.size(), [&] {
+        std::istringstream in(source);
+        BaselineTokenizer tokenizer(&in);
+        size_t count = 0;
+        for (; !tokenizer.IsEnd(); tokenizer.Next()) {
+            ++count;
+        }
+        return count;
+    });
+
+    Measure("istream", source.size(), [&] {
+        std::istringstream in(source);
+        Tokenizer tokenizer(&in);
+        size_t count = 0;
+        for (; !tokenizer.IsEnd(); tokenizer.Next()) {
+            ++count;
+        }
+        return count;
+    });
+
+    const char* names[] = {"scalar", "sse2", "avx2"};
+    for (auto level : {ScanLevel::kScalar, ScanLevel::kSse2, ScanLevel::kAvx2}) {
+        if (level > DetectScanLevel()) {
+            break;
+        }
+        SetScanLevel(level);
+        Measure(names[static_cast<int>(level)], source.size(), [&] {
+            Lexer lexer(source);
+            size_t count = 0;
+            for (; !lexer.IsEnd(); lexer.Next()) {
+                ++count;
+            }
+            return count;
+        });
+    }
+    SetScanLevel(DetectScanLevel());
+}
+
+}  // namespace
+
+int main() {
+    Run("code", MakeSource(8 << 20));
+    Run("data literal", MakeDataLiteral(8 << 20));
+}
@@ -0,0 +1,50 @@
+// Strong scaling of pmap and preduce: the same list of fixed-cost records
+// is mapped with 1, 2, 4, ... threads up to the number of cores, and the
+// wall time should shrink with the thread count. The map runs against a
+// serial map baseline, which shows what splitting the list and copying
+// results back costs.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. pmap_bench.cpp $(ls ../*.cpp) -o pmap_bench
+
+#include "parallel.h"
+#include "scheme.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr int kRecords = 2000;
+constexpr int kRepeats = 5;
+
+double Measure(Interpreter* interpreter, const std::string& request) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRepeats; ++i) {
+        interpreter->Run(request);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kRepeats;
+}
+
+}  // namespace
+
+int main() {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    Interpreter interpreter;
+    interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    interpreter.Run("(define (make n) (if (= n 0) '() (cons 12 (make (- n 1)))))");
+    interpreter.Run("(define records (make " + std::to_string(kRecords) + "))");
+
+    double serial = Measure(&interpreter, "(length (map fib records))");
+    std::printf("map          %7.3f s\n", serial);
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        SetParallelism(threads);
+        double map = Measure(&interpreter, "(length (pmap fib records))");
+        double reduce = Measure(&interpreter, "(preduce + 0 (pmap fib records))");
+        std::printf("%3u threads  pmap %7.3f s  speedup %5.2f  pmap+preduce %7.3f s\n", threads,
+                    map, serial / map, reduce);
+    }
+}
@@ -0,0 +1,50 @@
+// Tree walker against the bytecode VM on call-heavy code: a doubly
+// recursive (fib 27) and a 3M-iteration tail-recursive loop, both going
+// through global procedure bindings on every call.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. vm_bench.cpp $(ls ../*.cpp) -o vm_bench
+
+#include "scheme.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+constexpr int kRepeats = 3;
+
+const char* kDefinitions[] = {
+    "(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))",
+    "(define (loop i acc) (if (= i 0) acc (loop (- i 1) (+ acc 1))))",
+};
+
+double Measure(ExecutionMode mode, const char* request, std::string* result) {
+    Interpreter interpreter;
+    interpreter.SetExecutionMode(mode);
+    for (auto definition : kDefinitions) {
+        interpreter.Run(definition);
+    }
+    double best = 1e9;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        *result = interpreter.Run(request);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+}  // namespace
+
+int main() {
+    for (auto request : {"(fib 27)", "(loop 3000000 0)"}) {
+        std::string tree_result;
+        std::string vm_result;
+        double tree = Measure(ExecutionMode::kTreeWalk, request, &tree_result);
+        double vm = Measure(ExecutionMode::kBytecode, request, &vm_result);
+        std::printf("%-18s tree %7.3f s  vm %7.3f s  speedup %5.2f  %s\n", request, tree, vm,
+                    tree / vm, tree_result == vm_result ? "" : "MISMATCH");
+    }
+}
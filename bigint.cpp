@@ -0,0 +1,421 @@
+#include "bigint.h"
+#include "error.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+using Limbs = std::vector<uint32_t>;
+
+constexpr uint64_t kBase = uint64_t(1) << 32;
+// Largest power of ten in a limb, for decimal conversion.
+constexpr uint32_t kDecimalChunk = 1000000000;
+constexpr int kDecimalChunkDigits = 9;
+
+void Trim(Limbs* limbs) {
+    while (!limbs->empty() && limbs->back() == 0) {
+        limbs->pop_back();
+    }
+}
+
+int CompareMagnitude(const Limbs& lhs, const Limbs& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return lhs.size() < rhs.size() ? -1 : 1;
+    }
+    for (size_t i = lhs.size(); i-- > 0;) {
+        if (lhs[i] != rhs[i]) {
+            return lhs[i] < rhs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+Limbs AddMagnitude(const Limbs& lhs, const Limbs& rhs) {
+    const Limbs& longer = lhs.size() >= rhs.size() ? lhs : rhs;
+    const Limbs& shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+    Limbs res(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        uint64_t sum = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        res[i] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    res.back() = static_cast<uint32_t>(carry);
+    Trim(&res);
+    return res;
+}
+
+// lhs -= rhs, where lhs is at least rhs once shifted by offset limbs.
+void SubtractInPlace(Limbs* lhs, const Limbs& rhs, size_t offset = 0) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < rhs.size() || borrow; ++i) {
+        int64_t diff = int64_t((*lhs)[offset + i]) - borrow - (i < rhs.size() ? rhs[i] : 0);
+        borrow = diff < 0;
+        (*lhs)[offset + i] = static_cast<uint32_t>(diff);
+    }
+    Trim(lhs);
+}
+
+// lhs += rhs shifted by offset limbs; lhs must be long enough.
+void AddInPlace(Limbs* lhs, const Limbs& rhs, size_t offset) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < rhs.size() || carry; ++i) {
+        uint64_t sum = carry + (*lhs)[offset + i] + (i < rhs.size() ? rhs[i] : 0);
+        (*lhs)[offset + i] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+    }
+}
+
+Limbs MultiplySchoolbook(const Limbs& lhs, const Limbs& rhs) {
+    Limbs res(lhs.size() + rhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < rhs.size(); ++j) {
+            uint64_t product = uint64_t(lhs[i]) * rhs[j] + res[i + j] + carry;
+            res[i + j] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        res[i + rhs.size()] = static_cast<uint32_t>(carry);
+    }
+    Trim(&res);
+    return res;
+}
+
+// Low `size` limbs and the rest, each without leading zeros.
+std::pair<Limbs, Limbs> Split(const Limbs& limbs, size_t size) {
+    size = std::min(size, limbs.size());
+    Limbs low(limbs.begin(), limbs.begin() + size);
+    Limbs high(limbs.begin() + size, limbs.end());
+    Trim(&low);
+    return {std::move(low), std::move(high)};
+}
+
+// With x = x1 * B + x0 and y = y1 * B + y0, x * y is
+// x1 y1 B^2 + ((x0 + x1)(y0 + y1) - x0 y0 - x1 y1) B + x0 y0,
+// three half-size products instead of four.
+Limbs MultiplyMagnitude(const Limbs& lhs, const Limbs& rhs) {
+    if (lhs.empty() || rhs.empty()) {
+        return {};
+    }
+    if (std::min(lhs.size(), rhs.size()) < BigInteger::kKaratsubaThreshold) {
+        return MultiplySchoolbook(lhs, rhs);
+    }
+    size_t half = std::max(lhs.size(), rhs.size()) / 2;
+    auto [lhs_low, lhs_high] = Split(lhs, half);
+    auto [rhs_low, rhs_high] = Split(rhs, half);
+    Limbs low = MultiplyMagnitude(lhs_low, rhs_low);
+    Limbs high = MultiplyMagnitude(lhs_high, rhs_high);
+    Limbs middle = MultiplyMagnitude(AddMagnitude(lhs_low, lhs_high), AddMagnitude(rhs_low, rhs_high));
+    SubtractInPlace(&middle, low);
+    SubtractInPlace(&middle, high);
+
+    Limbs res(lhs.size() + rhs.size() + 1);
+    AddInPlace(&res, low, 0);
+    AddInPlace(&res, middle, half);
+    AddInPlace(&res, high, 2 * half);
+    Trim(&res);
+    return res;
+}
+
+// Divides in place by a single limb and returns the remainder.
+uint32_t DivideBySmall(Limbs* limbs, uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (size_t i = limbs->size(); i-- > 0;) {
+        uint64_t current = (remainder << 32) | (*limbs)[i];
+        (*limbs)[i] = static_cast<uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    Trim(limbs);
+    return static_cast<uint32_t>(remainder);
+}
+
+void MultiplyAddSmall(Limbs* limbs, uint32_t factor, uint32_t addend) {
+    uint64_t carry = addend;
+    for (auto& limb : *limbs) {
+        uint64_t product = uint64_t(limb) * factor + carry;
+        limb = static_cast<uint32_t>(product);
+        carry = product >> 32;
+    }
+    if (carry) {
+        limbs->push_back(static_cast<uint32_t>(carry));
+    }
+}
+
+// Knuth's algorithm D: long division with one limb per quotient digit,
+// estimated from the leading limbs after normalizing the divisor so that
+// its top bit is set; the estimate is off by at most two.
+void DivideMagnitude(const Limbs& lhs, const Limbs& rhs, Limbs* quotient, Limbs* remainder) {
+    if (CompareMagnitude(lhs, rhs) < 0) {
+        *quotient = {};
+        *remainder = lhs;
+        return;
+    }
+    if (rhs.size() == 1) {
+        *quotient = lhs;
+        uint32_t rest = DivideBySmall(quotient, rhs[0]);
+        *remainder = rest ? Limbs{rest} : Limbs{};
+        return;
+    }
+
+    int shift = __builtin_clz(rhs.back());
+    size_t n = rhs.size();
+    size_t m = lhs.size() - n;
+    Limbs divisor(n);
+    Limbs dividend(lhs.size() + 1);
+    for (size_t i = n; i-- > 0;) {
+        divisor[i] = (rhs[i] << shift) | (shift && i ? rhs[i - 1] >> (32 - shift) : 0);
+    }
+    dividend[lhs.size()] = shift ? lhs.back() >> (32 - shift) : 0;
+    for (size_t i = lhs.size(); i-- > 0;) {
+        dividend[i] = (lhs[i] << shift) | (shift && i ? lhs[i - 1] >> (32 - shift) : 0);
+    }
+
+    quotient->assign(m + 1, 0);
+    for (size_t j = m + 1; j-- > 0;) {
+        uint64_t top = (uint64_t(dividend[j + n]) << 32) | dividend[j + n - 1];
+        uint64_t estimate = top / divisor[n - 1];
+        uint64_t rest = top % divisor[n - 1];
+        while (estimate >= kBase ||
+               estimate * divisor[n - 2] > ((rest << 32) | dividend[j + n - 2])) {
+            --estimate;
+            rest += divisor[n - 1];
+            if (rest >= kBase) {
+                break;
+            }
+        }
+
+        int64_t borrow = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t product = estimate * divisor[i] + carry;
+            carry = product >> 32;
+            int64_t diff = int64_t(dividend[i + j]) - borrow - int64_t(product & 0xFFFFFFFF);
+            dividend[i + j] = static_cast<uint32_t>(diff);
+            borrow = diff < 0;
+        }
+        int64_t diff = int64_t(dividend[j + n]) - borrow - int64_t(carry);
+        dividend[j + n] = static_cast<uint32_t>(diff);
+
+        // The estimate was one too large: add the divisor back.
+        if (diff < 0) {
+            --estimate;
+            uint64_t sum_carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t sum = uint64_t(dividend[i + j]) + divisor[i] + sum_carry;
+                dividend[i + j] = static_cast<uint32_t>(sum);
+                sum_carry = sum >> 32;
+            }
+            dividend[j + n] += static_cast<uint32_t>(sum_carry);
+        }
+        (*quotient)[j] = static_cast<uint32_t>(estimate);
+    }
+    Trim(quotient);
+
+    remainder->assign(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        (*remainder)[i] = (dividend[i] >> shift) | (shift ? dividend[i + 1] << (32 - shift) : 0);
+    }
+    Trim(remainder);
+}
+
+}  // namespace
+
+BigInteger::BigInteger(int64_t value) : negative_(value < 0) {
+    // Negating in unsigned arithmetic also covers INT64_MIN.
+    uint64_t magnitude = negative_ ? 0 - static_cast<uint64_t>(value) : value;
+    while (magnitude) {
+        limbs_.push_back(static_cast<uint32_t>(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+BigInteger BigInteger::FromDecimal(std::string_view text) {
+    BigInteger res;
+    bool negative = false;
+    if (!text.empty() && (text[0] == '+' || text[0] == '-')) {
+        negative = text[0] == '-';
+        text.remove_prefix(1);
+    }
+    SyntaxAssert(!text.empty());
+    // The first chunk takes the leftover digits, the rest nine each.
+    size_t chunk = text.size() % kDecimalChunkDigits;
+    if (chunk == 0) {
+        chunk = kDecimalChunkDigits;
+    }
+    for (size_t pos = 0; pos < text.size(); pos += chunk, chunk = kDecimalChunkDigits) {
+        uint32_t value = 0;
+        uint32_t scale = 1;
+        for (size_t i = pos; i < pos + chunk; ++i) {
+            SyntaxAssert('0' <= text[i] && text[i] <= '9');
+            value = value * 10 + (text[i] - '0');
+            scale *= 10;
+        }
+        MultiplyAddSmall(&res.limbs_, scale, value);
+    }
+    res.negative_ = negative;
+    res.Normalize();
+    return res;
+}
+
+BigInteger BigInteger::FromLimbs(bool negative, std::vector<uint32_t> limbs) {
+    BigInteger res;
+    res.negative_ = negative;
+    res.limbs_ = std::move(limbs);
+    res.Normalize();
+    return res;
+}
+
+BigInteger BigInteger::FromDouble(double value) {
+    RuntimeAssert(std::isfinite(value) && std::trunc(value) == value);
+    if (std::fabs(value) < 0x1p63) {
+        return BigInteger(static_cast<int64_t>(value));
+    }
+    // value = mantissa * 2^shift with a 64-bit mantissa whose low bits are
+    // zero; shift is at least zero since |value| >= 2^63.
+    int exponent;
+    double fraction = std::frexp(std::fabs(value), &exponent);
+    auto mantissa = static_cast<uint64_t>(std::ldexp(fraction, 64));
+    size_t shift = exponent - 64;
+    Limbs limbs(shift / 32, 0);
+    size_t offset = shift % 32;
+    limbs.push_back(static_cast<uint32_t>(mantissa << offset));
+    limbs.push_back(static_cast<uint32_t>(mantissa >> (32 - offset)));
+    limbs.push_back(offset == 0 ? 0 : static_cast<uint32_t>(mantissa >> (64 - offset)));
+    return FromLimbs(value < 0, std::move(limbs));
+}
+
+bool BigInteger::FitsInt64() const {
+    if (limbs_.size() > 2) {
+        return false;
+    }
+    uint64_t magnitude = limbs_.empty() ? 0 : limbs_[0];
+    if (limbs_.size() == 2) {
+        magnitude |= uint64_t(limbs_[1]) << 32;
+    }
+    return magnitude <= (negative_ ? uint64_t(1) << 63 : uint64_t(INT64_MAX));
+}
+
+int64_t BigInteger::ToInt64() const {
+    RuntimeAssert(FitsInt64());
+    uint64_t magnitude = 0;
+    for (size_t i = limbs_.size(); i-- > 0;) {
+        magnitude = (magnitude << 32) | limbs_[i];
+    }
+    return static_cast<int64_t>(negative_ ? 0 - magnitude : magnitude);
+}
+
+double BigInteger::ToDouble() const {
+    if (FitsInt64()) {
+        return static_cast<double>(ToInt64());
+    }
+    // Takes the top 64 bits of the magnitude, at least 2^63 here, and folds
+    // every bit below them into the lowest one, so that converting them
+    // rounds exactly once.
+    size_t bits = limbs_.size() * 32 - __builtin_clz(limbs_.back());
+    size_t shift = bits - 64;
+    size_t limb = shift / 32;
+    size_t offset = shift % 32;
+    uint64_t top = (limbs_[limb] >> offset) | (uint64_t(limbs_[limb + 1]) << (32 - offset));
+    if (offset != 0) {
+        top |= uint64_t(limbs_[limb + 2]) << (64 - offset);
+    }
+    bool sticky = (limbs_[limb] & ((uint32_t(1) << offset) - 1)) != 0;
+    for (size_t i = 0; i < limb && !sticky; ++i) {
+        sticky = limbs_[i] != 0;
+    }
+    double res = std::ldexp(static_cast<double>(top | sticky), shift);
+    return negative_ ? -res : res;
+}
+
+std::string BigInteger::ToString() const {
+    if (IsZero()) {
+        return "0";
+    }
+    std::vector<uint32_t> chunks;
+    Limbs rest = limbs_;
+    while (!rest.empty()) {
+        chunks.push_back(DivideBySmall(&rest, kDecimalChunk));
+    }
+    std::string res = negative_ ? "-" : "";
+    res += std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        std::string digits = std::to_string(chunks[i]);
+        res.append(kDecimalChunkDigits - digits.size(), '0');
+        res += digits;
+    }
+    return res;
+}
+
+BigInteger BigInteger::operator-() const {
+    BigInteger res = *this;
+    res.negative_ = !negative_;
+    res.Normalize();
+    return res;
+}
+
+BigInteger operator+(const BigInteger& lhs, const BigInteger& rhs) {
+    BigInteger res;
+    if (lhs.negative_ == rhs.negative_) {
+        res.limbs_ = AddMagnitude(lhs.limbs_, rhs.limbs_);
+        res.negative_ = lhs.negative_;
+    } else if (CompareMagnitude(lhs.limbs_, rhs.limbs_) >= 0) {
+        res.limbs_ = lhs.limbs_;
+        SubtractInPlace(&res.limbs_, rhs.limbs_);
+        res.negative_ = lhs.negative_;
+    } else {
+        res.limbs_ = rhs.limbs_;
+        SubtractInPlace(&res.limbs_, lhs.limbs_);
+        res.negative_ = rhs.negative_;
+    }
+    res.Normalize();
+    return res;
+}
+
+BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs) {
+    return lhs + (-rhs);
+}
+
+BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
+    BigInteger res;
+    res.limbs_ = MultiplyMagnitude(lhs.limbs_, rhs.limbs_);
+    res.negative_ = lhs.negative_ != rhs.negative_;
+    res.Normalize();
+    return res;
+}
+
+BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs) {
+    RuntimeAssert(!rhs.IsZero());
+    BigInteger res;
+    Limbs remainder;
+    DivideMagnitude(lhs.limbs_, rhs.limbs_, &res.limbs_, &remainder);
+    res.negative_ = lhs.negative_ != rhs.negative_;
+    res.Normalize();
+    return res;
+}
+
+BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs) {
+    RuntimeAssert(!rhs.IsZero());
+    BigInteger res;
+    Limbs quotient;
+    DivideMagnitude(lhs.limbs_, rhs.limbs_, &quotient, &res.limbs_);
+    res.negative_ = lhs.negative_;
+    res.Normalize();
+    return res;
+}
+
+int Compare(const BigInteger& lhs, const BigInteger& rhs) {
+    if (lhs.negative_ != rhs.negative_) {
+        return lhs.negative_ ? -1 : 1;
+    }
+    int res = CompareMagnitude(lhs.limbs_, rhs.limbs_);
+    return lhs.negative_ ? -res : res;
+}
+
+void BigInteger::Normalize() {
+    Trim(&limbs_);
+    if (limbs_.empty()) {
+        negative_ = false;
+    }
+}
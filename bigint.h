@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Arbitrary-precision integer: a sign and a magnitude of base 2^32 limbs,
+// least significant first, without leading zero limbs. Zero has no limbs
+// and is never negative. Multiplication switches from the schoolbook method
+// to Karatsuba once both operands have kKaratsubaThreshold limbs.
+class BigInteger {
+public:
+    static constexpr size_t kKaratsubaThreshold = 32;
+
+    BigInteger() = default;
+    explicit BigInteger(int64_t value);
+
+    // Parses an optionally signed run of decimal digits.
+    static BigInteger FromDecimal(std::string_view text);
+    static BigInteger FromLimbs(bool negative, std::vector<uint32_t> limbs);
+    // Exact value of a finite double with no fractional part.
+    static BigInteger FromDouble(double value);
+
+    bool IsZero() const {
+        return limbs_.empty();
+    }
+
+    bool IsNegative() const {
+        return negative_;
+    }
+
+    const std::vector<uint32_t>& GetLimbs() const {
+        return limbs_;
+    }
+
+    bool FitsInt64() const;
+    int64_t ToInt64() const;
+    // Nearest double, rounding half to even; infinite past the double range.
+    double ToDouble() const;
+
+    std::string ToString() const;
+
+    BigInteger operator-() const;
+
+    friend BigInteger operator+(const BigInteger& lhs, const BigInteger& rhs);
+    friend BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs);
+    friend BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs);
+    // Truncates toward zero like int64_t division; the divisor must not be
+    // zero.
+    friend BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs);
+    // Remainder of that division, with the sign of the dividend.
+    friend BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs);
+
+    // Negative, zero or positive as lhs is less than, equal to or greater
+    // than rhs.
+    friend int Compare(const BigInteger& lhs, const BigInteger& rhs);
+
+private:
+    void Normalize();
+
+private:
+    bool negative_ = false;
+    std::vector<uint32_t> limbs_;
+};
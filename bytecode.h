@@ -0,0 +1,111 @@
+#pragma once
+
+#include "object.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class OpCode : uint8_t {
+    kConstant,         // push constants[a]
+    kLoadLocal,        // push slot b of the frame a levels up
+    kLoadGlobal,       // push the value of the symbol constants[a]
+    kCheckLocal,       // NameError unless slot b of frame a is bound
+    kCheckGlobal,      // NameError unless the symbol constants[a] is a global
+    kStoreLocal,       // pop into slot b of frame a, push ()
+    kStoreGlobal,      // pop into the global constants[a], push ()
+    kPop,              // drop the top of the stack
+    kJump,             // continue at a
+    kJumpIfFalse,      // pop, continue at a if the value is false
+    kJumpIfFalseKeep,  // continue at a if the top is false, pop otherwise
+    kJumpIfTrueKeep,   // continue at a if the top is true, pop otherwise
+    kMakeClosure,      // push constants[a], a lambda template, bound to the frame
+    kCheckSpecial,     // if the callee on top is a special form, replace it by
+                       // its result on the call form constants[a], continue at b
+    kCall,             // call the callee below a arguments
+    kTailCall,         // same, reusing the current frame
+    kReturn,           // return the top of the stack to the caller
+    kEvalTree,         // push constants[a] evaluated by the tree walker
+};
+
+struct Instruction {
+    OpCode op;
+    uint32_t a = 0;
+    uint32_t b = 0;
+};
+
+// Bytecode of a top-level form or of a lambda body together with its
+// constant pool. It is a heap object so that the constants stay alive as
+// long as some closure or VM frame refers to the code.
+class CompiledCode : public Object {
+public:
+    static constexpr ObjectType kType = ObjectType::kCompiledCode;
+
+    CompiledCode() : Object(kType) {
+    }
+
+    Object* Eval(Context& context) override {
+        RuntimeAssert(false);
+        return nullptr;
+    }
+
+    void Print(std::ostream* out) override {
+        RuntimeAssert(false);
+    }
+
+    void Trace(Heap* heap) override {
+        for (auto constant : constants_) {
+            heap->MarkObject(constant);
+        }
+    }
+
+    // What the symbol constants[a] of a kLoadGlobal last resolved to. Global
+    // bindings never move once defined, so a binding is kept for good; a
+    // builtin only until the interpreter defines another global name, which
+    // may shadow it.
+    struct GlobalRef {
+        Object** binding = nullptr;
+        Object* builtin = nullptr;
+        size_t globals = 0;
+    };
+
+    uint32_t AddConstant(Object* constant) {
+        constants_.push_back(constant);
+        global_refs_.emplace_back();
+        return constants_.size() - 1;
+    }
+
+    uint32_t Emit(OpCode op, uint32_t a = 0, uint32_t b = 0) {
+        instructions_.push_back(Instruction{op, a, b});
+        return instructions_.size() - 1;
+    }
+
+    // Points the jump emitted at position `at` to the next instruction.
+    void PatchJump(uint32_t at) {
+        instructions_[at].a = instructions_.size();
+    }
+
+    void PatchSpecialExit(uint32_t at) {
+        instructions_[at].b = instructions_.size();
+    }
+
+    const Instruction& GetInstruction(size_t pc) const {
+        return instructions_[pc];
+    }
+
+    Object* GetConstant(size_t index) const {
+        return constants_[index];
+    }
+
+    GlobalRef& GetGlobalRef(size_t index) {
+        return global_refs_[index];
+    }
+
+private:
+    std::vector<Instruction> instructions_;
+    std::vector<Object*> constants_;
+    std::vector<GlobalRef> global_refs_;
+
+private:
+    friend class ImageWriter;
+    friend class ImageReader;
+};
@@ -0,0 +1,257 @@
+#include "char_scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCHEME_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SCHEME_SWAR_DIGITS 1
+#endif
+
+namespace {
+
+// Most runs are only a few bytes long; the wide scanners only start past
+// this many bytes so that short tokens do not pay for the vector setup.
+constexpr size_t kScalarPrefix = 8;
+
+std::atomic<ScanLevel> scan_level{DetectScanLevel()};
+
+size_t SkipSpacesScalar(std::string_view text, size_t pos, size_t limit = SIZE_MAX) {
+    limit = std::min(limit, text.size());
+    while (pos < limit && HasCharClass(text[pos], kSpaceChar)) {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t SkipSymbolCharsScalar(std::string_view text, size_t pos, size_t limit = SIZE_MAX) {
+    limit = std::min(limit, text.size());
+    while (pos < limit && HasCharClass(text[pos], kSymbolChar)) {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t SkipDigits(std::string_view text, size_t pos) {
+    while (pos < text.size() && HasCharClass(text[pos], kDigitChar)) {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t ParseDigitsScalar(std::string_view text, size_t pos, uint64_t* value) {
+    while (pos < text.size() && HasCharClass(text[pos], kDigitChar)) {
+        *value = *value * 10 + (text[pos] - '0');
+        ++pos;
+    }
+    return pos;
+}
+
+#ifdef SCHEME_X86_SIMD
+
+// Byte masks are built with signed compares, which is fine because every
+// character of interest is ASCII: bytes >= 0x80 compare as negative and
+// fall outside all ranges.
+
+__attribute__((target("sse2"))) __m128i InRange128(__m128i v, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+__attribute__((target("sse2"))) __m128i SpaceMask128(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), InRange128(v, '\t', '\r'));
+}
+
+__attribute__((target("sse2"))) __m128i SymbolMask128(__m128i v) {
+    // Setting bit 5 maps upper case letters onto lower case ones and nothing
+    // else into 'a'..'z'.
+    __m128i alpha = InRange128(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i res = _mm_or_si128(alpha, InRange128(v, '0', '9'));
+    res = _mm_or_si128(res, InRange128(v, '<', '?'));
+    res = _mm_or_si128(res, InRange128(v, '*', '+'));
+    res = _mm_or_si128(res, _mm_cmpeq_epi8(v, _mm_set1_epi8('!')));
+    res = _mm_or_si128(res, _mm_cmpeq_epi8(v, _mm_set1_epi8('#')));
+    res = _mm_or_si128(res, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+    return _mm_or_si128(res, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+}
+
+// Skips 16 bytes at a time while all of them are in the class.
+template <__m128i (*Mask)(__m128i)>
+__attribute__((target("sse2"))) size_t SkipClass128(std::string_view text, size_t pos) {
+    while (pos + 16 <= text.size()) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        uint32_t outside = ~static_cast<uint32_t>(_mm_movemask_epi8(Mask(v))) & 0xFFFF;
+        if (outside != 0) {
+            return pos + __builtin_ctz(outside);
+        }
+        pos += 16;
+    }
+    return pos;
+}
+
+__attribute__((target("avx2"))) __m256i InRange256(__m256i v, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+__attribute__((target("avx2"))) __m256i SpaceMask256(__m256i v) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                           InRange256(v, '\t', '\r'));
+}
+
+__attribute__((target("avx2"))) __m256i SymbolMask256(__m256i v) {
+    __m256i alpha = InRange256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i res = _mm256_or_si256(alpha, InRange256(v, '0', '9'));
+    res = _mm256_or_si256(res, InRange256(v, '<', '?'));
+    res = _mm256_or_si256(res, InRange256(v, '*', '+'));
+    res = _mm256_or_si256(res, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('!')));
+    res = _mm256_or_si256(res, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('#')));
+    res = _mm256_or_si256(res, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+    return _mm256_or_si256(res, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+}
+
+template <__m256i (*Mask)(__m256i)>
+__attribute__((target("avx2"))) size_t SkipClass256(std::string_view text, size_t pos) {
+    while (pos + 32 <= text.size()) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + pos));
+        uint32_t outside = ~static_cast<uint32_t>(_mm256_movemask_epi8(Mask(v)));
+        if (outside != 0) {
+            return pos + __builtin_ctz(outside);
+        }
+        pos += 32;
+    }
+    return pos;
+}
+
+#endif  // SCHEME_X86_SIMD
+
+#ifdef SCHEME_SWAR_DIGITS
+
+uint64_t LoadEightBytes(const char* data) {
+    uint64_t res;
+    std::memcpy(&res, data, sizeof(res));
+    return res;
+}
+
+bool IsEightDigits(uint64_t chunk) {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+            (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+
+// Combines adjacent digits pairwise, then the pairs and the quads, with the
+// first digit in the lowest byte.
+uint64_t ParseEightDigits(uint64_t chunk) {
+    const uint64_t mask = 0x000000FF000000FF;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+    chunk -= 0x3030303030303030;
+    chunk = (chunk * 10) + (chunk >> 8);
+    return (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+}
+
+#endif  // SCHEME_SWAR_DIGITS
+
+}  // namespace
+
+ScanLevel DetectScanLevel() {
+#ifdef SCHEME_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanLevel::kAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return ScanLevel::kSse2;
+    }
+#endif
+    return ScanLevel::kScalar;
+}
+
+ScanLevel GetScanLevel() {
+    return scan_level.load(std::memory_order_relaxed);
+}
+
+void SetScanLevel(ScanLevel level) {
+    if (level > DetectScanLevel()) {
+        level = DetectScanLevel();
+    }
+    scan_level.store(level, std::memory_order_relaxed);
+}
+
+size_t SkipSpaces(std::string_view text, size_t pos) {
+#ifdef SCHEME_X86_SIMD
+    size_t prefix_end = pos + kScalarPrefix;
+    pos = SkipSpacesScalar(text, pos, prefix_end);
+    if (pos < prefix_end) {
+        return pos;
+    }
+    switch (GetScanLevel()) {
+        case ScanLevel::kAvx2:
+            pos = SkipClass256<SpaceMask256>(text, pos);
+            break;
+        case ScanLevel::kSse2:
+            pos = SkipClass128<SpaceMask128>(text, pos);
+            break;
+        case ScanLevel::kScalar:
+            break;
+    }
+#endif
+    return SkipSpacesScalar(text, pos);
+}
+
+size_t SkipSymbolChars(std::string_view text, size_t pos) {
+#ifdef SCHEME_X86_SIMD
+    size_t prefix_end = pos + kScalarPrefix;
+    pos = SkipSymbolCharsScalar(text, pos, prefix_end);
+    if (pos < prefix_end) {
+        return pos;
+    }
+    switch (GetScanLevel()) {
+        case ScanLevel::kAvx2:
+            pos = SkipClass256<SymbolMask256>(text, pos);
+            break;
+        case ScanLevel::kSse2:
+            pos = SkipClass128<SymbolMask128>(text, pos);
+            break;
+        case ScanLevel::kScalar:
+            break;
+    }
+#endif
+    return SkipSymbolCharsScalar(text, pos);
+}
+
+size_t ParseDigits(std::string_view text, size_t pos, uint64_t* value) {
+#ifdef SCHEME_SWAR_DIGITS
+    if (GetScanLevel() != ScanLevel::kScalar) {
+        while (pos + 8 <= text.size()) {
+            uint64_t chunk = LoadEightBytes(text.data() + pos);
+            if (!IsEightDigits(chunk)) {
+                break;
+            }
+            *value = *value * 100000000 + ParseEightDigits(chunk);
+            pos += 8;
+        }
+    }
+#endif
+    return ParseDigitsScalar(text, pos, value);
+}
+
+size_t SkipFraction(std::string_view text, size_t pos) {
+    if (pos + 1 < text.size() && text[pos] == '.' && HasCharClass(text[pos + 1], kDigitChar)) {
+        pos = SkipDigits(text, pos + 1);
+    }
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        size_t digits = pos + 1;
+        if (digits < text.size() && (text[digits] == '+' || text[digits] == '-')) {
+            ++digits;
+        }
+        if (digits < text.size() && HasCharClass(text[digits], kDigitChar)) {
+            pos = SkipDigits(text, digits);
+        }
+    }
+    return pos;
+}
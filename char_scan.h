@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Character classes of the lexer. Whitespace is what std::isspace accepts
+// in the C locale, symbol characters are letters, digits and <=>*/#?!-+.
+enum CharClass : uint8_t {
+    kSpaceChar = 1,
+    kDigitChar = 2,
+    kSymbolChar = 4,
+    // Anything that may appear in a request outside of a token's text.
+    kSyntaxChar = 8,
+};
+
+inline constexpr std::array<uint8_t, 256> kCharClasses = [] {
+    std::array<uint8_t, 256> table{};
+    for (int c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        table[c] = kSpaceChar | kSyntaxChar;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+        table[c] = kDigitChar | kSymbolChar | kSyntaxChar;
+    }
+    for (int c = 'a'; c <= 'z'; ++c) {
+        table[c] = kSymbolChar | kSyntaxChar;
+        table[c - 'a' + 'A'] = kSymbolChar | kSyntaxChar;
+    }
+    for (int c : {'<', '=', '>', '*', '/', '#', '?', '!', '-', '+'}) {
+        table[c] = kSymbolChar | kSyntaxChar;
+    }
+    for (int c : {'.', '\'', '(', ')'}) {
+        table[c] = kSyntaxChar;
+    }
+    return table;
+}();
+
+inline bool HasCharClass(char c, CharClass char_class) {
+    return kCharClasses[static_cast<unsigned char>(c)] & char_class;
+}
+
+// Implementation used by the scanners below. The widest one the CPU supports
+// is picked at startup; benchmarks and tests may force a narrower one.
+enum class ScanLevel { kScalar, kSse2, kAvx2 };
+
+ScanLevel DetectScanLevel();
+ScanLevel GetScanLevel();
+void SetScanLevel(ScanLevel level);
+
+// Index of the first byte at or after pos that is not whitespace.
+size_t SkipSpaces(std::string_view text, size_t pos);
+
+// Index of the first byte at or after pos that is not a symbol character.
+size_t SkipSymbolChars(std::string_view text, size_t pos);
+
+// Parses the run of decimal digits starting at pos, eight at a time where
+// possible, and returns the index after it. The value wraps modulo 2^64.
+size_t ParseDigits(std::string_view text, size_t pos, uint64_t* value);
+
+// Index after the fraction and exponent of a decimal literal whose integer
+// digits end at pos, i.e. a '.' and digits and/or an 'e' or 'E' with an
+// optionally signed exponent. Returns pos if neither follows.
+size_t SkipFraction(std::string_view text, size_t pos);
@@ -0,0 +1,207 @@
+#include "compiler.h"
+
+namespace {
+
+bool IsSymbol(Object* obj, SymbolId id) {
+    return Is<Symbol>(obj) && As<Symbol>(obj)->GetId() == id;
+}
+
+// Heads of special forms the analyzer dispatches on stay symbols, the others
+// are resolved to the builtin itself.
+bool IsForm(Object* head, SymbolId id) {
+    return IsSymbol(head, id) || head == FunctionRegistry::Instance().GetFunction(id);
+}
+
+bool IsVariable(Object* obj) {
+    return Is<Symbol>(obj) || Is<LocalVariable>(obj);
+}
+
+class Compiler {
+public:
+    Compiler(CompiledCode* code, Context& context) : code_(code), context_(context) {
+    }
+
+    void CompileSequence(const std::vector<Object*>& body) {
+        for (size_t i = 0; i < body.size(); ++i) {
+            bool last = i + 1 == body.size();
+            CompileExpression(body[i], last);
+            if (!last) {
+                code_->Emit(OpCode::kPop);
+            }
+        }
+        code_->Emit(OpCode::kReturn);
+    }
+
+    void CompileExpression(Object* form, bool tail) {
+        if (Is<LocalVariable>(form)) {
+            auto variable = As<LocalVariable>(form);
+            code_->Emit(OpCode::kLoadLocal, variable->GetDepth(), variable->GetSlot());
+        } else if (Is<Symbol>(form)) {
+            code_->Emit(OpCode::kLoadGlobal, code_->AddConstant(form));
+        } else if (Is<Cell>(form)) {
+            CompileForm(As<Cell>(form), tail);
+        } else if (form == nullptr) {
+            EmitFallback(form);
+        } else {
+            // Numbers, and builtins placed in the tree, evaluate to themselves.
+            code_->Emit(OpCode::kConstant, code_->AddConstant(form));
+        }
+    }
+
+private:
+    void EmitFallback(Object* form) {
+        code_->Emit(OpCode::kEvalTree, code_->AddConstant(form));
+    }
+
+    void CompileForm(Cell* form, bool tail) {
+        List list = ParseToList(form);
+        if (list.is_wrong || form->GetFirst() == nullptr) {
+            EmitFallback(form);
+            return;
+        }
+        const auto& args = list.objects;
+        Object* head = args[0];
+        bool compiled = true;
+        if (Is<LambdaBuilderFunction>(head)) {
+            compiled = CompileLambda(form, list);
+        } else if (IsForm(head, SymbolTable::kQuote)) {
+            compiled = args.size() == 2;
+            if (compiled) {
+                code_->Emit(OpCode::kConstant, code_->AddConstant(args[1]));
+            }
+        } else if (IsForm(head, SymbolTable::kIf)) {
+            compiled = CompileIf(args, tail);
+        } else if (IsForm(head, SymbolTable::kAnd)) {
+            CompileLogical(args, OpCode::kJumpIfFalseKeep, true, tail);
+        } else if (IsForm(head, SymbolTable::kOr)) {
+            CompileLogical(args, OpCode::kJumpIfTrueKeep, false, tail);
+        } else if (IsForm(head, SymbolTable::kDefine)) {
+            compiled = CompileAssignment(args, false);
+        } else if (IsForm(head, SymbolTable::kSet)) {
+            compiled = CompileAssignment(args, true);
+        } else if (IsForm(head, SymbolTable::kLambda) || IsForm(head, SymbolTable::kSetCar) ||
+                   IsForm(head, SymbolTable::kSetCdr)) {
+            compiled = false;
+        } else {
+            CompileCall(form, args, tail);
+        }
+        if (!compiled) {
+            EmitFallback(form);
+        }
+    }
+
+    bool CompileLambda(Cell* form, const List& list) {
+        const auto& args = list.objects;
+        if (args.size() < 3) {
+            return false;
+        }
+        if (args[1] != nullptr) {
+            if (!Is<Cell>(args[1])) {
+                return false;
+            }
+            for (auto param : ParseToList(As<Cell>(args[1])).objects) {
+                if (!Is<Symbol>(param)) {
+                    return false;
+                }
+            }
+        }
+        auto lambda = As<LambdaFunction>(As<Function>(args[0])->Eval(Arguments(&args, 0, args.size()), context_));
+        lambda->SetCode(CompileBody(lambda->GetBody(), context_));
+        code_->Emit(OpCode::kMakeClosure, code_->AddConstant(lambda));
+        return true;
+    }
+
+    bool CompileIf(const std::vector<Object*>& args, bool tail) {
+        if (args.size() != 3 && args.size() != 4) {
+            return false;
+        }
+        CompileExpression(args[1], false);
+        uint32_t to_else = code_->Emit(OpCode::kJumpIfFalse);
+        CompileExpression(args[2], tail);
+        uint32_t to_end = code_->Emit(OpCode::kJump);
+        code_->PatchJump(to_else);
+        if (args.size() == 4) {
+            CompileExpression(args[3], tail);
+        } else {
+            code_->Emit(OpCode::kConstant, code_->AddConstant(nullptr));
+        }
+        code_->PatchJump(to_end);
+        return true;
+    }
+
+    void CompileLogical(const std::vector<Object*>& args, OpCode jump, bool empty, bool tail) {
+        if (args.size() == 1) {
+            code_->Emit(OpCode::kConstant, code_->AddConstant(GetBooleanFunction(empty, context_)));
+            return;
+        }
+        std::vector<uint32_t> exits;
+        for (size_t i = 1; i + 1 < args.size(); ++i) {
+            CompileExpression(args[i], false);
+            exits.push_back(code_->Emit(jump));
+        }
+        CompileExpression(args.back(), tail);
+        for (auto exit : exits) {
+            code_->PatchJump(exit);
+        }
+    }
+
+    // define and set!; the latter checks the variable before the value.
+    bool CompileAssignment(const std::vector<Object*>& args, bool is_set) {
+        if (args.size() != 3 || !IsVariable(args[1]) || (!is_set && args[2] == nullptr)) {
+            return false;
+        }
+        Object* target = args[1];
+        if (is_set) {
+            if (Is<LocalVariable>(target)) {
+                auto variable = As<LocalVariable>(target);
+                code_->Emit(OpCode::kCheckLocal, variable->GetDepth(), variable->GetSlot());
+            } else {
+                code_->Emit(OpCode::kCheckGlobal, code_->AddConstant(target));
+            }
+        }
+        CompileExpression(args[2], false);
+        if (Is<LocalVariable>(target)) {
+            auto variable = As<LocalVariable>(target);
+            code_->Emit(OpCode::kStoreLocal, variable->GetDepth(), variable->GetSlot());
+        } else {
+            code_->Emit(OpCode::kStoreGlobal, code_->AddConstant(target));
+        }
+        return true;
+    }
+
+    // A head the analyzer resolved to a builtin is known at compile time,
+    // so only other heads need kCheckSpecial.
+    void CompileCall(Cell* form, const std::vector<Object*>& args, bool tail) {
+        CompileExpression(args[0], false);
+        bool check = !Is<Function>(args[0]) || As<Function>(args[0])->IsSpecialForm();
+        uint32_t check_at = 0;
+        if (check) {
+            check_at = code_->Emit(OpCode::kCheckSpecial, code_->AddConstant(form));
+        }
+        for (size_t i = 1; i < args.size(); ++i) {
+            CompileExpression(args[i], false);
+        }
+        code_->Emit(tail ? OpCode::kTailCall : OpCode::kCall, args.size() - 1);
+        if (check) {
+            code_->PatchSpecialExit(check_at);
+        }
+    }
+
+private:
+    CompiledCode* code_;
+    Context& context_;
+};
+
+}  // namespace
+
+CompiledCode* Compile(Object* form, Context& context) {
+    CompiledCode* code = context.GetHeap()->Make<CompiledCode>();
+    Compiler(code, context).CompileSequence({form});
+    return code;
+}
+
+CompiledCode* CompileBody(const std::vector<Object*>& body, Context& context) {
+    CompiledCode* code = context.GetHeap()->Make<CompiledCode>();
+    Compiler(code, context).CompileSequence(body);
+    return code;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "bytecode.h"
+
+// Compiles an analyzed top-level form into bytecode run in the global
+// context. Forms the compiler does not handle natively, such as malformed
+// special forms, are delegated to the tree walker so that both engines
+// produce the same results and errors.
+CompiledCode* Compile(Object* form, Context& context);
+
+// Compiles the body of a lambda, run in the frame returned by
+// LambdaFunction::BindArguments.
+CompiledCode* CompileBody(const std::vector<Object*>& body, Context& context);
@@ -1,30 +1,23 @@
 #include "context.h"
+#include "heap.h"
 
-bool Context::HasVariable(const std::string& name) const {
-    if (HasLocalVariable(name)) {
-        return true;
-    }
-    std::shared_ptr<Context> now = up_;
-    while (now) {
-        if (now->HasLocalVariable(name)) {
-            return true;
-        }
-        now = now->up_;
-    }
-    return false;
+bool Context::HasVariable(SymbolId id) const {
+    return global_->variables_.count(id);
 }
 
-Object* Context::GetVariable(const std::string& name) {
-    RuntimeAssert(HasVariable(name));
-    if (HasLocalVariable(name)) {
-        return GetLocalVariable(name);
+Object* Context::GetVariable(SymbolId id) {
+    auto it = global_->variables_.find(id);
+    RuntimeAssert(it != global_->variables_.end());
+    return it->second;
+}
+
+void Context::Trace(Heap* heap) const {
+    for (auto& [id, value] : variables_) {
+        heap->MarkObject(value);
     }
-    std::shared_ptr<Context> now = up_;
-    while (now) {
-        if (now->HasLocalVariable(name)) {
-            return now->GetLocalVariable(name);
+    for (auto value : slots_) {
+        if (value != kUnboundSlot) {
+            heap->MarkObject(value);
         }
-        now = now->up_;
     }
-    return nullptr;
-}
\ No newline at end of file
+}
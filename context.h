@@ -1,53 +1,113 @@
 #pragma once
 
 #include "scheme_fwd.h"
+#include "symbol_table.h"
 
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
+// Placeholder stored in frame slots whose internal define has not run yet.
+inline Object* const kUnboundSlot = reinterpret_cast<Object*>(alignof(void*));
+
+// Either the global environment, where top-level defines live in a map
+// keyed by symbol id, or a lambda frame holding its parameters and internal
+// defines in slots assigned by the analyzer.
 class Context : public std::enable_shared_from_this<Context> {
 public:
     Context() = default;
 
-    Context(std::shared_ptr<Context>& other) : up_(other), data_(other->data_) {
-        variables_.clear();
+    Context(std::shared_ptr<Context> up, size_t frame_size)
+        : slots_(frame_size, kUnboundSlot), up_(std::move(up)), global_(up_->global_), heap_(up_->heap_) {
     }
 
-    void SetData(std::vector<std::shared_ptr<Object>>* data) {
-        data_ = data;
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    // Reinitializes a pooled frame for a new call.
+    void Reset(std::shared_ptr<Context> up, size_t frame_size) {
+        slots_.assign(frame_size, kUnboundSlot);
+        up_ = std::move(up);
+        global_ = up_->global_;
+        heap_ = up_->heap_;
     }
 
-    void AddPtrToData(std::shared_ptr<Object> ptr) {
-        data_->push_back(ptr);
+    // Drops the bindings and the link to the defining context of a frame
+    // returned to the pool.
+    void Clear() {
+        slots_.clear();
+        up_.reset();
     }
 
-    bool HasVariable(const std::string& name) const;
+    void SetHeap(Heap* heap) {
+        heap_ = heap;
+    }
 
-    Object* GetVariable(const std::string& name);
+    Heap* GetHeap() {
+        return heap_;
+    }
 
-    void AddVariable(const std::string& name, Object* value) {
-        variables_[name] = value;
+    bool HasVariable(SymbolId id) const;
+
+    Object* GetVariable(SymbolId id);
+
+    // The global binding of id, or nullptr if there is none. A binding stays
+    // at the same address for the lifetime of the global environment.
+    Object** FindGlobal(SymbolId id) {
+        auto it = global_->variables_.find(id);
+        return it == global_->variables_.end() ? nullptr : &it->second;
     }
 
-    void SetUp(std::shared_ptr<Context> context) {
-        up_ = context;
+    // Globals are never removed, so this only changes when a name is defined
+    // for the first time.
+    size_t GetGlobalCount() const {
+        return global_->variables_.size();
     }
 
-    std::vector<std::shared_ptr<Object>>* GetData() {
-        return data_;
+    // Bindings are only written through contexts of the same heap, so a
+    // pmap worker cannot assign variables of the interpreter it serves.
+    void AddVariable(SymbolId id, Object* value) {
+        RuntimeAssert(global_->heap_ == heap_);
+        global_->variables_[id] = value;
     }
 
-private:
-    bool HasLocalVariable(const std::string& name) const {
-        return variables_.count(name);
+    // Addresses come from the analyzer, or from a heap image that may be
+    // corrupt, so they are checked against the frame chain.
+    Object* GetSlot(size_t depth, size_t slot) {
+        Context* frame = GetFrame(depth);
+        RuntimeAssert(slot < frame->slots_.size());
+        return frame->slots_[slot];
     }
 
-    Object* GetLocalVariable(const std::string& name) {
-        return variables_.at(name);
+    void SetSlot(size_t depth, size_t slot, Object* value) {
+        Context* frame = GetFrame(depth);
+        RuntimeAssert(frame->heap_ == heap_ && slot < frame->slots_.size());
+        frame->slots_[slot] = value;
+    }
+
+    // Marks the values bound in this frame only; Heap walks the up_ chain.
+    void Trace(Heap* heap) const;
+
+private:
+    Context* GetFrame(size_t depth) {
+        Context* frame = this;
+        while (depth-- > 0) {
+            frame = frame->up_.get();
+            RuntimeAssert(frame != nullptr);
+        }
+        return frame;
     }
 
 private:
-    std::unordered_map<std::string, Object*> variables_;
+    std::unordered_map<SymbolId, Object*> variables_;
+    std::vector<Object*> slots_;
     std::shared_ptr<Context> up_ = nullptr;
-    std::vector<std::shared_ptr<Object>>* data_ = nullptr;
-};
\ No newline at end of file
+    Context* global_ = this;
+    Heap* heap_ = nullptr;
+    uint64_t gc_epoch_ = 0;
+
+private:
+    friend class Heap;
+    friend class ImageWriter;
+    friend class ImageReader;
+};
@@ -0,0 +1,91 @@
+#include "form_cache.h"
+#include "bytecode.h"
+#include "object.h"
+#include "symbol_table.h"
+
+namespace {
+
+bool IsSymbol(Object* obj, SymbolId id) {
+    return Is<Symbol>(obj) && As<Symbol>(obj)->GetId() == id;
+}
+
+// Whether form holds literal data that running it could mutate: a vector,
+// or a quoted pair. Reading the text again gives every uncached run its own
+// copy, so such forms are not shared between runs.
+bool HasMutableLiteral(Object* form) {
+    for (; Is<Cell>(form); form = As<Cell>(form)->GetSecond()) {
+        Object* first = As<Cell>(form)->GetFirst();
+        Object* rest = As<Cell>(form)->GetSecond();
+        if (IsSymbol(first, SymbolTable::kQuote) && Is<Cell>(rest) &&
+            Is<Cell>(As<Cell>(rest)->GetFirst())) {
+            return true;
+        }
+        if (HasMutableLiteral(first)) {
+            return true;
+        }
+    }
+    return Is<Vector>(form);
+}
+
+}  // namespace
+
+FormCache::FormCache(Heap* heap) : heap_(heap) {
+    heap_->AddRootProvider(this);
+}
+
+FormCache::~FormCache() {
+    heap_->RemoveRootProvider(this);
+}
+
+CachedForm* FormCache::Find(const std::string& text) {
+    if (capacity_ == 0) {
+        return nullptr;
+    }
+    auto it = index_.find(text);
+    if (it == index_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->cached;
+}
+
+CachedForm* FormCache::Insert(const std::string& text, Object* form) {
+    if (capacity_ == 0 || form == nullptr || index_.count(text) || HasMutableLiteral(form)) {
+        return nullptr;
+    }
+    entries_.push_front(Entry{text, CachedForm{form}});
+    index_.emplace(entries_.front().text, entries_.begin());
+    EvictToCapacity();
+    // The new entry is the most recent one, so a nonzero capacity keeps it.
+    return &entries_.front().cached;
+}
+
+void FormCache::SetCapacity(size_t capacity) {
+    capacity_ = capacity;
+    EvictToCapacity();
+}
+
+FormCacheStats FormCache::GetStats() const {
+    FormCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.size = entries_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+void FormCache::TraceRoots(Heap* heap) {
+    for (auto& entry : entries_) {
+        heap->MarkObject(entry.cached.form);
+        heap->MarkObject(entry.cached.code);
+    }
+}
+
+void FormCache::EvictToCapacity() {
+    while (entries_.size() > capacity_) {
+        index_.erase(entries_.back().text);
+        entries_.pop_back();
+    }
+}
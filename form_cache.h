@@ -0,0 +1,65 @@
+#pragma once
+
+#include "heap.h"
+#include "scheme_fwd.h"
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct FormCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+// Analyzed form of a request, and its bytecode once it has run in bytecode
+// mode.
+struct CachedForm {
+    Object* form = nullptr;
+    CompiledCode* code = nullptr;
+};
+
+// LRU cache from request text to its parsed and analyzed form, so that a
+// repeated request skips the reader, and in bytecode mode the compiler too.
+// Cached forms and code are heap roots and are shared by every run of the
+// same text, so forms with literal data a run could mutate, vectors and
+// quoted pairs, are not cached. A capacity of zero disables the cache.
+class FormCache : public RootProvider {
+public:
+    explicit FormCache(Heap* heap);
+    FormCache(const FormCache&) = delete;
+    FormCache& operator=(const FormCache&) = delete;
+    ~FormCache();
+
+    // Both return nullptr when there is no entry for text, Insert also when
+    // it does not cache form. An entry stays valid until the next Insert or
+    // SetCapacity.
+    CachedForm* Find(const std::string& text);
+    CachedForm* Insert(const std::string& text, Object* form);
+
+    void SetCapacity(size_t capacity);
+    FormCacheStats GetStats() const;
+
+    void TraceRoots(Heap* heap) override;
+
+private:
+    struct Entry {
+        std::string text;
+        CachedForm cached;
+    };
+
+    void EvictToCapacity();
+
+private:
+    Heap* heap_;
+    size_t capacity_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    // Most recently used first. Keys view the text of their entry.
+    std::list<Entry> entries_;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+};
@@ -0,0 +1,138 @@
+#include "form_stream.h"
+#include "char_scan.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+// Whether rest could begin the fraction or exponent of a number once more
+// input arrives.
+bool IsFractionPrefix(std::string_view rest) {
+    if (rest == "." || rest == "e" || rest == "E") {
+        return true;
+    }
+    return rest.size() == 2 && (rest[0] == 'e' || rest[0] == 'E') &&
+           (rest[1] == '+' || rest[1] == '-');
+}
+
+// End of the atom starting at pos, split the way the lexer splits it: a
+// number ends at its last digit even if symbol characters follow. A number
+// that may still continue past the buffer ends with it until the input has
+// ended.
+size_t AtomEnd(std::string_view text, size_t pos, bool at_eof) {
+    size_t digits = pos;
+    if (text[pos] == '+' || text[pos] == '-') {
+        ++digits;
+    }
+    if (digits < text.size() && HasCharClass(text[digits], kDigitChar)) {
+        uint64_t unused = 0;
+        size_t end = SkipFraction(text, ParseDigits(text, digits, &unused));
+        if (!at_eof && IsFractionPrefix(text.substr(end))) {
+            return text.size();
+        }
+        return end;
+    }
+    return SkipSymbolChars(text, pos);
+}
+
+}  // namespace
+
+FormStream::FormStream(std::istream* in, size_t chunk_size)
+    : in_(in), chunk_size_(std::max<size_t>(chunk_size, 1)) {
+}
+
+bool FormStream::Next(std::string_view* form) {
+    buffer_.erase(0, consumed_);
+    scan_ -= consumed_;
+    consumed_ = 0;
+    while (true) {
+        size_t end = FindFormEnd();
+        if (end != std::string::npos) {
+            *form = std::string_view(buffer_).substr(0, end);
+            consumed_ = end;
+            return true;
+        }
+        // Once the input has ended, one more scan settles atoms that ran
+        // up to the end of the buffer.
+        if (at_eof_) {
+            break;
+        }
+        Fill();
+    }
+    // The input ended inside a form.
+    if (SkipSpaces(buffer_, 0) == buffer_.size()) {
+        return false;
+    }
+    *form = buffer_;
+    consumed_ = buffer_.size();
+    scan_ = buffer_.size();
+    depth_ = 0;
+    return true;
+}
+
+// Appends whatever the stream has buffered, waiting for at least one byte.
+bool FormStream::Fill() {
+    std::streambuf* source = in_->rdbuf();
+    if (at_eof_ || source == nullptr || source->sgetc() == std::streambuf::traits_type::eof()) {
+        at_eof_ = true;
+        return false;
+    }
+    std::streamsize available = std::clamp<std::streamsize>(
+        source->in_avail(), 1, static_cast<std::streamsize>(chunk_size_));
+    size_t old_size = buffer_.size();
+    buffer_.resize(old_size + available);
+    buffer_.resize(old_size + source->sgetn(&buffer_[old_size], available));
+    return true;
+}
+
+// Advances over whole tokens, tracking bracket depth, until a datum closes
+// at depth zero. An atom running up to the end of the buffer may continue
+// in the next chunk, so it only counts once the input has ended.
+size_t FormStream::FindFormEnd() {
+    while (true) {
+        scan_ = SkipSpaces(buffer_, scan_);
+        if (scan_ == buffer_.size()) {
+            return std::string::npos;
+        }
+        char c = buffer_[scan_];
+        if (c == '(') {
+            ++depth_;
+            ++scan_;
+            continue;
+        }
+        if (c == '#' && scan_ + 1 == buffer_.size() && !at_eof_) {
+            // Could be the start of a vector literal.
+            return std::string::npos;
+        }
+        if (c == '#' && scan_ + 1 < buffer_.size() && buffer_[scan_ + 1] == '(') {
+            ++depth_;
+            scan_ += 2;
+            continue;
+        }
+        if (c == '\'') {
+            ++scan_;
+            continue;
+        }
+        if (c == ')') {
+            --depth_;
+            ++scan_;
+        } else if (HasCharClass(c, kSymbolChar)) {
+            size_t end = AtomEnd(buffer_, scan_, at_eof_);
+            if (end == buffer_.size() && !at_eof_) {
+                return std::string::npos;
+            }
+            scan_ = end;
+        } else if (c == '.' && depth_ > 0) {
+            ++scan_;
+        } else {
+            // A stray dot or a byte the lexer rejects; cut the form here.
+            ++scan_;
+            depth_ = 0;
+        }
+        if (depth_ <= 0) {
+            depth_ = 0;
+            return scan_;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+
+// Splits a stream into the source text of its top-level forms as they
+// arrive. Input is read in chunks of whatever the stream has available, at
+// most chunk_size bytes, and consumed text is dropped, so the buffer only
+// ever holds the form being read plus one chunk.
+class FormStream {
+public:
+    static constexpr size_t kDefaultChunkSize = 64 << 10;
+
+    explicit FormStream(std::istream* in, size_t chunk_size = kDefaultChunkSize);
+
+    // Stores the text of the next form, valid until the following call.
+    // Returns false once only whitespace is left. Malformed input is handed
+    // out as is, for the reader to report.
+    bool Next(std::string_view* form);
+
+private:
+    bool Fill();
+    size_t FindFormEnd();
+
+private:
+    std::istream* in_;
+    size_t chunk_size_;
+    std::string buffer_;
+    // End of the last form handed out, and where scanning for the next one
+    // resumes after more input arrives.
+    size_t consumed_ = 0;
+    size_t scan_ = 0;
+    int depth_ = 0;
+    bool at_eof_ = false;
+};
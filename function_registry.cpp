@@ -2,18 +2,81 @@
 #include "object.h"
 
 // static
-FunctionRegistry& FunctionRegistry::Instance() {
-    static FunctionRegistry singleton;
+const FunctionRegistry& FunctionRegistry::Instance() {
+    // Initialization of a function-local static runs exactly once even when
+    // several threads get here first.
+    static const FunctionRegistry singleton;
     return singleton;
 }
 
-Function* FunctionRegistry::GetFunction(const std::string& name, Context& context) {
-    SyntaxAssert(producers_.count(name));
-    auto res = producers_[name]->Produce();
-    context.AddPtrToData(std::dynamic_pointer_cast<Object>(res));
-    return res.get();
-}
-
-bool FunctionRegistry::HasFunction(const std::string& name) {
-    return producers_.count(name);
+FunctionRegistry::FunctionRegistry() {
+    RegisterFunction<PNumberFunction>("number?");
+    RegisterFunction<EqualFunction>("=");
+    RegisterFunction<MonIncFunction>("<");
+    RegisterFunction<MonDecFunction>(">");
+    RegisterFunction<MonNonIncFunction>(">=");
+    RegisterFunction<MonNonDecFunction>("<=");
+    RegisterFunction<PlusFunction>("+");
+    RegisterFunction<MinusFunction>("-");
+    RegisterFunction<MultiplyFunction>("*");
+    RegisterFunction<DivisionFunction>("/");
+    RegisterFunction<MaxFunction>("max");
+    RegisterFunction<MinFunction>("min");
+    RegisterFunction<AbsFunction>("abs");
+    RegisterFunction<PPairFunction>("pair?");
+    RegisterFunction<PNullFunction>("null?");
+    RegisterFunction<PListFunction>("list?");
+    RegisterFunction<ConsFunction>("cons");
+    RegisterFunction<CarFunction>("car");
+    RegisterFunction<CdrFunction>("cdr");
+    RegisterFunction<ListFunction>("list");
+    RegisterFunction<ListRefFunction>("list-ref");
+    RegisterFunction<ListTailFunction>("list-tail");
+    RegisterLibraryFunction<LengthFunction>("length");
+    RegisterLibraryFunction<AppendFunction>("append");
+    RegisterLibraryFunction<ReverseFunction>("reverse");
+    RegisterLibraryFunction<LastPairFunction>("last-pair");
+    RegisterLibraryFunction<MemberFunction>("member");
+    RegisterLibraryFunction<AssocFunction>("assoc");
+    RegisterLibraryFunction<MapFunction>("map");
+    RegisterLibraryFunction<ForEachFunction>("for-each");
+    RegisterLibraryFunction<FilterFunction>("filter");
+    RegisterLibraryFunction<FoldLeftFunction>("fold-left");
+    RegisterLibraryFunction<ApplyFunction>("apply");
+    RegisterLibraryFunction<PMapFunction>("pmap");
+    RegisterLibraryFunction<PReduceFunction>("preduce");
+    RegisterLibraryFunction<PVectorFunction>("vector?");
+    RegisterLibraryFunction<MakeVectorFunction>("make-vector");
+    RegisterLibraryFunction<VectorFunction>("vector");
+    RegisterLibraryFunction<VectorLengthFunction>("vector-length");
+    RegisterLibraryFunction<VectorRefFunction>("vector-ref");
+    RegisterLibraryFunction<VectorSetFunction>("vector-set!");
+    RegisterLibraryFunction<PHashTableFunction>("hash-table?");
+    RegisterLibraryFunction<MakeHashTableFunction>("make-hash-table");
+    RegisterLibraryFunction<HashTableRefFunction>("hash-table-ref");
+    RegisterLibraryFunction<HashTableRefDefaultFunction>("hash-table-ref/default");
+    RegisterLibraryFunction<HashTableSetFunction>("hash-table-set!");
+    RegisterLibraryFunction<HashTableDeleteFunction>("hash-table-delete!");
+    RegisterLibraryFunction<HashTableContainsFunction>("hash-table-contains?");
+    RegisterLibraryFunction<HashTableCountFunction>("hash-table-count");
+    RegisterLibraryFunction<HashTableKeysFunction>("hash-table-keys");
+    RegisterLibraryFunction<HashTableValuesFunction>("hash-table-values");
+    RegisterLibraryFunction<HashTableToAlistFunction>("hash-table->alist");
+    RegisterLibraryFunction<HashTableWalkFunction>("hash-table-walk");
+    RegisterFunction<True>("#t");
+    RegisterFunction<False>("#f");
+    RegisterFunction<PBooleanFunction>("boolean?");
+    RegisterFunction<NotFuntion>("not");
+    RegisterFunction<AndFunction>("and");
+    RegisterFunction<OrFunction>("or");
+    RegisterFunction<QuoteFunction>("quote");
+    RegisterFunction<IfFunction>("if");
+    RegisterFunction<LambdaBuilderFunction>("lambda");
+    RegisterFunction<DefineFunction>("define");
+    RegisterFunction<SetFunction>("set!");
+    RegisterFunction<SetCdrFunction>("set-cdr!");
+    RegisterFunction<SetCarFunction>("set-car!");
+    RegisterFunction<PSymbolFunction>("symbol?");
+    RegisterLibraryFunction<EqFunction>("eq?");
+    RegisterLibraryFunction<StructuralEqualFunction>("equal?");
 }
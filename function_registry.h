@@ -2,38 +2,75 @@
 
 #include "scheme_fwd.h"
 #include "context.h"
+#include "heap.h"
+#include "symbol_table.h"
 
+#include <memory>
+#include <optional>
 #include <type_traits>
-#include <unordered_map>
+#include <vector>
 
-class IFunctionProducer {
+// Table of builtins by symbol id. It is filled once, on first use, and is
+// read-only afterwards, so interpreters on different threads share it
+// without locking.
+class FunctionRegistry {
 public:
-    virtual std::shared_ptr<Function> Produce() = 0;
-    virtual ~IFunctionProducer() = default;
-};
+    static const FunctionRegistry& Instance();
 
-template <typename T>
-class FunctionProducer : public IFunctionProducer {
-    std::shared_ptr<Function> Produce() override {
-        return std::make_shared<T>();
+    bool HasFunction(SymbolId id) const {
+        return id < functions_.size() && functions_[id] != nullptr;
     }
-};
 
-class FunctionRegistry {
-public:
-    static FunctionRegistry& Instance();
+    Function* GetFunction(SymbolId id) const {
+        SyntaxAssert(HasFunction(id));
+        return functions_[id].get();
+    }
+
+    // Library procedures came after the core builtins, and programs may
+    // define their own under the same names; lambda bindings and global
+    // defines of these names shadow the builtin.
+    bool IsLibraryFunction(SymbolId id) const {
+        return id < library_.size() && library_[id];
+    }
 
+    // Id of the name a builtin is registered under; for saving references
+    // to builtins by name.
+    std::optional<SymbolId> FindId(const Function* function) const {
+        for (SymbolId id = 0; id < functions_.size(); ++id) {
+            if (functions_[id].get() == function) {
+                return id;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    FunctionRegistry();
+
+    // Builtins are stateless, so each one is a single permanent object
+    // shared by all interpreters.
     template <typename T>
     void RegisterFunction(const std::string& name) {
         static_assert(std::is_base_of_v<Function, T>);
-        producers_[name] = std::make_shared<FunctionProducer<T>>();
+        SymbolId id = SymbolTable::Instance().Intern(name);
+        if (functions_.size() <= id) {
+            functions_.resize(id + 1);
+        }
+        functions_[id].reset(Heap::MakePermanent<T>());
     }
 
-    bool HasFunction(const std::string& name);
-    Function* GetFunction(const std::string& name, Context& context);
+    template <typename T>
+    void RegisterLibraryFunction(const std::string& name) {
+        RegisterFunction<T>(name);
+        SymbolId id = SymbolTable::Instance().Intern(name);
+        if (library_.size() <= id) {
+            library_.resize(id + 1);
+        }
+        library_[id] = true;
+    }
 
 private:
-    FunctionRegistry() = default;
-
-    std::unordered_map<std::string, std::shared_ptr<IFunctionProducer>> producers_;
+    // Indexed by symbol id, so a lookup is a bounds check and a load.
+    std::vector<std::unique_ptr<Function>> functions_;
+    std::vector<bool> library_;
 };
@@ -0,0 +1,154 @@
+#include "hash_table.h"
+
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Finalizer of MurmurHash3, so that consecutive integers spread over the
+// whole table.
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccd;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53;
+    value ^= value >> 33;
+    return value;
+}
+
+uint64_t Combine(uint64_t seed, uint64_t value) {
+    return Mix(seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2)));
+}
+
+}  // namespace
+
+uint64_t HashObject(Object* obj) {
+    if (obj == nullptr) {
+        return 0;
+    }
+    if (Is<Number>(obj)) {
+        return Mix(As<Number>(obj)->GetValue());
+    }
+    if (Is<BigNum>(obj)) {
+        const BigInteger& value = As<BigNum>(obj)->GetValue();
+        uint64_t res = value.IsNegative();
+        for (auto limb : value.GetLimbs()) {
+            res = Combine(res, limb);
+        }
+        return res;
+    }
+    if (Is<Flonum>(obj)) {
+        // 0.0 and -0.0 are equal but differ in their bits.
+        double value = As<Flonum>(obj)->GetValue();
+        uint64_t bits = 0;
+        if (value != 0) {
+            std::memcpy(&bits, &value, sizeof(bits));
+        }
+        return Combine(uint64_t(ObjectType::kFlonum), bits);
+    }
+    if (Is<Symbol>(obj)) {
+        return Combine(uint64_t(ObjectType::kSymbol), As<Symbol>(obj)->GetId());
+    }
+    if (Is<Cell>(obj)) {
+        uint64_t res = uint64_t(ObjectType::kCell);
+        for (; Is<Cell>(obj); obj = As<Cell>(obj)->GetSecond()) {
+            res = Combine(res, HashObject(As<Cell>(obj)->GetFirst()));
+        }
+        return Combine(res, HashObject(obj));
+    }
+    if (Is<Vector>(obj)) {
+        uint64_t res = uint64_t(ObjectType::kVector);
+        for (size_t i = 0; i < As<Vector>(obj)->Size(); ++i) {
+            res = Combine(res, HashObject(As<Vector>(obj)->Get(i)));
+        }
+        return res;
+    }
+    return Mix(reinterpret_cast<uintptr_t>(obj));
+}
+
+void HashTable::Print(std::ostream* out) {
+    (*out) << "#<hash-table " << size_ << ">";
+}
+
+void HashTable::Trace(Heap* heap) {
+    ForEach([heap](Object* key, Object* value) {
+        heap->MarkObject(key);
+        heap->MarkObject(value);
+    });
+}
+
+Object* const* HashTable::Find(Object* key) const {
+    size_t index = FindSlot(key, HashObject(key));
+    return index == slots_.size() ? nullptr : &slots_[index].value;
+}
+
+void HashTable::Set(Object* key, Object* value) {
+    uint64_t hash = HashObject(key);
+    if (size_t index = FindSlot(key, hash); index != slots_.size()) {
+        slots_[index].value = value;
+        return;
+    }
+    // Keeps at least a quarter of the slots empty so that probes end soon.
+    if ((used_ + 1) * 4 > slots_.size() * 3) {
+        size_t capacity = kMinCapacity;
+        while (capacity * 3 < (size_ + 1) * 4 * 2) {
+            capacity *= 2;
+        }
+        Rehash(capacity);
+    }
+    size_t mask = slots_.size() - 1;
+    size_t index = hash & mask;
+    while (slots_[index].state == SlotState::kFull) {
+        index = (index + 1) & mask;
+    }
+    if (slots_[index].state == SlotState::kEmpty) {
+        ++used_;
+    }
+    slots_[index] = Slot{hash, key, value, SlotState::kFull};
+    ++size_;
+}
+
+bool HashTable::Erase(Object* key) {
+    size_t index = FindSlot(key, HashObject(key));
+    if (index == slots_.size()) {
+        return false;
+    }
+    slots_[index] = Slot{};
+    slots_[index].state = SlotState::kErased;
+    --size_;
+    return true;
+}
+
+size_t HashTable::FindSlot(Object* key, uint64_t hash) const {
+    if (slots_.empty()) {
+        return 0;
+    }
+    size_t mask = slots_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        const Slot& slot = slots_[index];
+        if (slot.state == SlotState::kEmpty) {
+            return slots_.size();
+        }
+        if (slot.state == SlotState::kFull && slot.hash == hash && IsEqual(slot.key, key)) {
+            return index;
+        }
+    }
+}
+
+void HashTable::Rehash(size_t capacity) {
+    size_t old_bytes = ExtraBytes();
+    std::vector<Slot> old = std::exchange(slots_, std::vector<Slot>(capacity));
+    heap_->ResizeExtraBytes(old_bytes, ExtraBytes());
+    used_ = size_;
+    size_t mask = capacity - 1;
+    for (auto& slot : old) {
+        if (slot.state != SlotState::kFull) {
+            continue;
+        }
+        size_t index = slot.hash & mask;
+        while (slots_[index].state == SlotState::kFull) {
+            index = (index + 1) & mask;
+        }
+        slots_[index] = slot;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "object.h"
+
+#include <cstdint>
+#include <vector>
+
+// Hash consistent with IsEqual: numbers and symbols hash by value, lists
+// and vectors by their elements, everything else by identity.
+uint64_t HashObject(Object* obj);
+
+// Mutable map from keys compared with equal? to values. Open addressing
+// with linear probing over a power-of-two table; erased slots are left as
+// tombstones until the next rehash.
+class HashTable : public Object {
+public:
+    static constexpr ObjectType kType = ObjectType::kHashTable;
+
+    // Slot storage grows as bindings are added and is reported to heap.
+    explicit HashTable(Heap* heap) : Object(kType), heap_(heap) {
+    }
+
+    void Print(std::ostream* out) override;
+
+    Object* Eval(Context& context) override {
+        return this;
+    }
+
+    void Trace(Heap* heap) override;
+
+    size_t ExtraBytes() const override {
+        return slots_.capacity() * sizeof(Slot);
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // The value bound to key, or nullptr if there is none.
+    Object* const* Find(Object* key) const;
+
+    void Set(Object* key, Object* value);
+
+    // Whether key was bound.
+    bool Erase(Object* key);
+
+    // Calls f(key, value) for every binding; f must not modify the table.
+    template <class F>
+    void ForEach(F f) const {
+        for (auto& slot : slots_) {
+            if (slot.state == SlotState::kFull) {
+                f(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kMinCapacity = 8;
+
+    enum class SlotState : uint8_t { kEmpty, kFull, kErased };
+
+    struct Slot {
+        uint64_t hash = 0;
+        Object* key = nullptr;
+        Object* value = nullptr;
+        SlotState state = SlotState::kEmpty;
+    };
+
+    // Index of the slot holding key, or slots_.size() if it is absent.
+    size_t FindSlot(Object* key, uint64_t hash) const;
+    void Rehash(size_t capacity);
+
+private:
+    Heap* heap_;
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    // Full and erased slots, which both lengthen probe sequences.
+    size_t used_ = 0;
+};
@@ -0,0 +1,193 @@
+#include "heap.h"
+#include "object.h"
+#include "context.h"
+
+#include <algorithm>
+#include <iterator>
+
+Heap::Heap() {
+    small_integers_.reserve(kMaxCachedInteger - kMinCachedInteger + 1);
+    for (int64_t value = kMinCachedInteger; value <= kMaxCachedInteger; ++value) {
+        small_integers_.push_back(Make<Number>(value));
+    }
+}
+
+Heap::~Heap() {
+    for (auto& allocation : objects_) {
+        delete allocation.object;
+    }
+}
+
+Symbol* Heap::InternSymbol(SymbolId id) {
+    if (symbols_by_id_.size() <= id) {
+        symbols_by_id_.resize(id + 1, nullptr);
+    }
+    if (symbols_by_id_[id] == nullptr) {
+        symbols_by_id_[id] = Make<Symbol>(id);
+    }
+    return symbols_by_id_[id];
+}
+
+bool Heap::Owns(const Object* obj) const {
+    return cells_.Contains(obj) || numbers_.Contains(obj) || flonums_.Contains(obj) ||
+           symbols_.Contains(obj) || worker_objects_.count(obj) != 0;
+}
+
+Number* Heap::MakeInteger(int64_t value) {
+    if (kMinCachedInteger <= value && value <= kMaxCachedInteger) {
+        return small_integers_[value - kMinCachedInteger];
+    }
+    return Make<Number>(value);
+}
+
+void Heap::AddRootContext(Context* context) {
+    root_contexts_.push_back(context);
+}
+
+void Heap::RemoveRootContext(Context* context) {
+    // Roots are registered and removed in LIFO order, search from the back.
+    auto it = std::find(root_contexts_.rbegin(), root_contexts_.rend(), context);
+    if (it != root_contexts_.rend()) {
+        root_contexts_.erase(std::next(it).base());
+    }
+}
+
+std::shared_ptr<Context> Heap::AcquireFrame(std::shared_ptr<Context> up, size_t frame_size) {
+    std::shared_ptr<Context> frame;
+    if (free_frames_.empty()) {
+        frame = std::make_shared<Context>(std::move(up), frame_size);
+    } else {
+        frame = std::move(free_frames_.back());
+        free_frames_.pop_back();
+        frame->Reset(std::move(up), frame_size);
+    }
+    frame->SetHeap(this);
+    AddRootContext(frame.get());
+    return frame;
+}
+
+void Heap::ReleaseFrame(std::shared_ptr<Context> frame) {
+    RemoveRootContext(frame.get());
+    // Any other owner is a closure or a nested frame that captured it.
+    if (frame.use_count() == 1 && free_frames_.size() < kMaxFreeFrames) {
+        frame->Clear();
+        free_frames_.push_back(std::move(frame));
+    }
+}
+
+void Heap::AddRootProvider(RootProvider* provider) {
+    root_providers_.push_back(provider);
+}
+
+void Heap::RemoveRootProvider(RootProvider* provider) {
+    auto it = std::find(root_providers_.begin(), root_providers_.end(), provider);
+    if (it != root_providers_.end()) {
+        root_providers_.erase(it);
+    }
+}
+
+void Heap::MarkObject(Object* obj) {
+    if (obj == nullptr || obj->marked_) {
+        return;
+    }
+    obj->marked_ = true;
+    gray_.push_back(obj);
+}
+
+void Heap::MarkContext(Context* context) {
+    while (context != nullptr && context->gc_epoch_ != epoch_) {
+        context->gc_epoch_ = epoch_;
+        context->Trace(this);
+        context = context->up_.get();
+    }
+}
+
+void Heap::Collect() {
+    auto start = std::chrono::steady_clock::now();
+    ++epoch_;
+    Mark();
+    Sweep();
+    threshold_ = std::max(min_threshold_, bytes_);
+    allocated_since_gc_ = 0;
+
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    ++stats_.collections;
+    stats_.last_pause = pause;
+    stats_.max_pause = std::max(stats_.max_pause, pause);
+    stats_.total_pause += pause;
+}
+
+void Heap::SetThreshold(size_t bytes) {
+    min_threshold_ = bytes;
+    threshold_ = bytes;
+}
+
+GcStats Heap::GetStats() const {
+    GcStats stats = stats_;
+    stats.heap_objects = objects_.size() + cells_.Size() + numbers_.Size() + flonums_.Size() +
+                         symbols_.Size();
+    stats.heap_bytes = bytes_;
+    stats.threshold_bytes = threshold_;
+    return stats;
+}
+
+void Heap::Mark() {
+    for (auto context : root_contexts_) {
+        MarkContext(context);
+    }
+    for (auto obj : stack_) {
+        MarkObject(obj);
+    }
+    for (auto symbol : symbols_by_id_) {
+        MarkObject(symbol);
+    }
+    for (auto number : small_integers_) {
+        MarkObject(number);
+    }
+    for (auto provider : root_providers_) {
+        provider->TraceRoots(this);
+    }
+    // Tracing a lambda may reach contexts which in turn reach new objects,
+    // so the gray list is drained iteratively instead of recursing.
+    while (!gray_.empty()) {
+        Object* obj = gray_.back();
+        gray_.pop_back();
+        obj->Trace(this);
+    }
+}
+
+template <typename T>
+void Heap::SweepPool(ObjectPool<T>* pool) {
+    size_t freed = pool->Sweep([](T* obj) {
+        if (obj->marked_) {
+            obj->marked_ = false;
+            return false;
+        }
+        return true;
+    });
+    bytes_ -= freed * sizeof(T);
+    stats_.freed_objects += freed;
+    stats_.freed_bytes += freed * sizeof(T);
+}
+
+void Heap::Sweep() {
+    SweepPool(&cells_);
+    SweepPool(&numbers_);
+    SweepPool(&flonums_);
+    SweepPool(&symbols_);
+    size_t live = 0;
+    for (auto& allocation : objects_) {
+        if (allocation.object->marked_) {
+            allocation.object->marked_ = false;
+            objects_[live++] = allocation;
+            continue;
+        }
+        size_t size = allocation.size + allocation.object->ExtraBytes();
+        bytes_ -= size;
+        ++stats_.freed_objects;
+        stats_.freed_bytes += size;
+        delete allocation.object;
+    }
+    objects_.resize(live);
+}
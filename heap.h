@@ -0,0 +1,251 @@
+#pragma once
+
+#include "scheme_fwd.h"
+#include "object_pool.h"
+#include "symbol_table.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+struct GcStats {
+    size_t heap_objects = 0;
+    size_t heap_bytes = 0;
+    size_t threshold_bytes = 0;
+    size_t collections = 0;
+    size_t freed_objects = 0;
+    size_t freed_bytes = 0;
+    std::chrono::nanoseconds last_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::chrono::nanoseconds total_pause{0};
+};
+
+// Implemented by components that hold heap references outside of objects,
+// contexts and the evaluator stack, e.g. the bytecode VM's call frames.
+class RootProvider {
+public:
+    virtual void TraceRoots(Heap* heap) = 0;
+
+protected:
+    ~RootProvider() = default;
+};
+
+// Mark-and-sweep heap owning every Object an interpreter creates.
+// Roots are the registered contexts plus the evaluator stack, i.e. values
+// that are referenced only from native frames. Collection happens only at
+// safepoints (MaybeCollect), so code between two safepoints may hold raw
+// pointers to fresh objects without rooting them.
+class Heap {
+public:
+    static constexpr size_t kDefaultThreshold = 1 << 20;
+    static constexpr int64_t kMinCachedInteger = -128;
+    static constexpr int64_t kMaxCachedInteger = 1023;
+
+    Heap();
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+    ~Heap();
+
+    template <typename T, typename... Args>
+    T* Make(Args&&... args) {
+        T* res;
+        if constexpr (std::is_same_v<T, Cell>) {
+            res = cells_.Allocate(std::forward<Args>(args)...);
+        } else if constexpr (std::is_same_v<T, Number>) {
+            res = numbers_.Allocate(std::forward<Args>(args)...);
+        } else if constexpr (std::is_same_v<T, Symbol>) {
+            res = symbols_.Allocate(std::forward<Args>(args)...);
+        } else if constexpr (std::is_same_v<T, Flonum>) {
+            res = flonums_.Allocate(std::forward<Args>(args)...);
+        } else {
+            res = new T(std::forward<Args>(args)...);
+            objects_.push_back(Allocation{res, sizeof(T)});
+            if (worker_mode_) {
+                worker_objects_.insert(res);
+            }
+            bytes_ += res->ExtraBytes();
+            allocated_since_gc_ += res->ExtraBytes();
+        }
+        bytes_ += sizeof(T);
+        allocated_since_gc_ += sizeof(T);
+        return res;
+    }
+
+    // Objects shared by every heap, such as builtins. They are never swept,
+    // and being born marked, collectors never write to them either.
+    template <typename T>
+    static T* MakePermanent() {
+        T* res = new T();
+        res->marked_ = true;
+        return res;
+    }
+
+    // Numbers are immutable, so integers in the cached range share one
+    // preallocated object each and arithmetic on them does not allocate.
+    Number* MakeInteger(int64_t value);
+
+    // Returns the interpreter's single Symbol object for the given id, so
+    // symbols read from different places compare equal by pointer.
+    Symbol* InternSymbol(SymbolId id);
+
+    void AddRootContext(Context* context);
+    void RemoveRootContext(Context* context);
+
+    // Activation frames for lambda calls, linked to the closure's defining
+    // context but allocating from this heap. An acquired frame is a root
+    // until it is released; released frames that did not escape into a
+    // closure are kept for reuse, so calls that capture nothing do not
+    // allocate.
+    std::shared_ptr<Context> AcquireFrame(std::shared_ptr<Context> up, size_t frame_size);
+    void ReleaseFrame(std::shared_ptr<Context> frame);
+
+    void AddRootProvider(RootProvider* provider);
+    void RemoveRootProvider(RootProvider* provider);
+
+    void PushRoot(Object* obj) {
+        stack_.push_back(obj);
+    }
+
+    // The evaluator stack itself, for engines that keep operands on it.
+    std::vector<Object*>& GetStack() {
+        return stack_;
+    }
+
+    void MarkObject(Object* obj);
+    void MarkContext(Context* context);
+
+    // Called by objects whose ExtraBytes change after allocation, such as
+    // hash tables when they rehash, to keep the heap's count exact.
+    void ResizeExtraBytes(size_t old_bytes, size_t new_bytes) {
+        bytes_ += new_bytes - old_bytes;
+        if (new_bytes > old_bytes) {
+            allocated_since_gc_ += new_bytes - old_bytes;
+        }
+    }
+
+    // Safepoint: collects if enough memory was allocated since the last cycle.
+    void MaybeCollect() {
+        if (allocated_since_gc_ >= threshold_) {
+            Collect();
+        }
+    }
+
+    void Collect();
+
+    void SetThreshold(size_t bytes);
+    GcStats GetStats() const;
+
+    // Puts a heap into the mode used by pmap and preduce workers, which
+    // evaluate on behalf of a waiting interpreter and read its objects. The
+    // heap never collects, since marking would write to those shared
+    // objects, and builtins refuse to mutate objects in this mode.
+    void SetWorkerMode() {
+        worker_mode_ = true;
+        threshold_ = SIZE_MAX;
+    }
+
+    bool IsWorkerMode() const {
+        return worker_mode_;
+    }
+
+    // Whether obj was allocated from this worker heap, as opposed to read
+    // from the waiting interpreter. Only worker heaps index the objects
+    // they allocate outside the pools.
+    bool Owns(const Object* obj) const;
+
+    // Pops everything pushed onto the evaluator stack during its lifetime.
+    class RootGuard {
+    public:
+        explicit RootGuard(Heap* heap) : heap_(heap), size_(heap->stack_.size()) {
+        }
+        RootGuard(const RootGuard&) = delete;
+        RootGuard& operator=(const RootGuard&) = delete;
+        ~RootGuard() {
+            heap_->stack_.resize(size_);
+        }
+
+    private:
+        Heap* heap_;
+        size_t size_;
+    };
+
+    // Releases a frame acquired for a call when the call exits.
+    class FrameGuard {
+    public:
+        explicit FrameGuard(Heap* heap) : heap_(heap) {
+        }
+        FrameGuard(Heap* heap, std::shared_ptr<Context> frame) : heap_(heap), frame_(std::move(frame)) {
+        }
+        FrameGuard(const FrameGuard&) = delete;
+        FrameGuard& operator=(const FrameGuard&) = delete;
+        ~FrameGuard() {
+            Reset(nullptr);
+        }
+
+        // Releases the current frame, if any, and guards the given one.
+        void Reset(std::shared_ptr<Context> frame) {
+            if (frame_) {
+                heap_->ReleaseFrame(std::move(frame_));
+            }
+            frame_ = std::move(frame);
+        }
+
+        // Hands the frame over to the caller without releasing it.
+        std::shared_ptr<Context> Release() {
+            return std::move(frame_);
+        }
+
+        Context& operator*() const {
+            return *frame_;
+        }
+
+    private:
+        Heap* heap_;
+        std::shared_ptr<Context> frame_;
+    };
+
+private:
+    static constexpr size_t kMaxFreeFrames = 1024;
+
+    struct Allocation {
+        Object* object;
+        size_t size;
+    };
+
+    void Mark();
+    void Sweep();
+
+    template <typename T>
+    void SweepPool(ObjectPool<T>* pool);
+
+private:
+    // List nodes, numbers and symbols dominate allocation, so they get
+    // dedicated slabs; everything else goes through operator new.
+    ObjectPool<Cell> cells_;
+    ObjectPool<Number> numbers_;
+    ObjectPool<Flonum> flonums_;
+    ObjectPool<Symbol> symbols_;
+    std::vector<Allocation> objects_;
+    std::unordered_set<const Object*> worker_objects_;
+    std::vector<Object*> stack_;
+    std::vector<Context*> root_contexts_;
+    std::vector<RootProvider*> root_providers_;
+    std::vector<std::shared_ptr<Context>> free_frames_;
+    std::vector<Symbol*> symbols_by_id_;
+    std::vector<Number*> small_integers_;
+    std::vector<Object*> gray_;
+
+    size_t bytes_ = 0;
+    size_t allocated_since_gc_ = 0;
+    size_t min_threshold_ = kDefaultThreshold;
+    size_t threshold_ = kDefaultThreshold;
+    uint64_t epoch_ = 0;
+    bool worker_mode_ = false;
+
+    GcStats stats_;
+};
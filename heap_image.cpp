@@ -0,0 +1,685 @@
+#include "heap_image.h"
+#include "bytecode.h"
+#include "hash_table.h"
+#include "object.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Layout, all integers as LEB128 varints:
+//   magic, version
+//   symbols:  count, then each name as length and bytes
+//   objects:  count, then each object's type and scalar fields
+//   frames:   count, then each closure frame's parent and size; parents
+//             come first, frame 0 is the global environment
+//   refs:     the references of every object, in object order
+//   globals:  count, then symbol and reference pairs
+//   slots:    the slot values of every frame, in frame order
+// Objects and frames are all created before any reference is resolved, so
+// cycles through closures need no special handling. Hash table entries are
+// inserted only once all references are resolved, since a key is hashed by
+// its contents.
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'C', 'M', 'I', 'M', 'A', 'G', 'E'};
+constexpr uint64_t kVersion = 1;
+
+// References: nullptr, the unbound slot marker, then object indices.
+constexpr uint64_t kNullRef = 0;
+constexpr uint64_t kUnboundRef = 1;
+constexpr uint64_t kFirstObjectRef = 2;
+
+// Record tags; builtins are saved by name regardless of their type.
+enum class ImageTag : uint8_t {
+    kNumber,
+    kSymbol,
+    kLocalVariable,
+    kCell,
+    kCompiledCode,
+    kBuiltin,
+    kLambdaBuilder,
+    kLambda,
+    kBigNum,
+    kFlonum,
+    kVector,
+    kHashTable,
+};
+
+}  // namespace
+
+class ImageWriter {
+public:
+    explicit ImageWriter(std::ostream* out) : out_(out) {
+    }
+
+    void Write(Context& context) {
+        Context& global = *context.global_;
+        AddContext(&global);
+        for (auto& [id, value] : global.variables_) {
+            AddSymbol(id);
+            AddObject(value);
+        }
+        // Discovery order: an object's references are added when it is
+        // visited, which may add further frames and objects.
+        for (size_t i = 0; i < objects_.size(); ++i) {
+            Visit(objects_[i]);
+        }
+
+        out_->write(kMagic, sizeof(kMagic));
+        WriteVarint(kVersion);
+
+        WriteVarint(symbols_.size());
+        for (auto id : symbols_) {
+            const std::string& name = SymbolTable::Instance().GetName(id);
+            WriteVarint(name.size());
+            out_->write(name.data(), name.size());
+        }
+
+        WriteVarint(objects_.size());
+        for (auto obj : objects_) {
+            WriteScalars(obj);
+        }
+
+        WriteVarint(contexts_.size());
+        for (size_t i = 1; i < contexts_.size(); ++i) {
+            WriteVarint(context_ids_.at(contexts_[i]->up_.get()));
+            WriteVarint(contexts_[i]->slots_.size());
+        }
+
+        for (auto obj : objects_) {
+            WriteRefs(obj);
+        }
+
+        WriteVarint(global.variables_.size());
+        for (auto& [id, value] : global.variables_) {
+            WriteVarint(symbol_ids_.at(id));
+            WriteRef(value);
+        }
+
+        for (size_t i = 1; i < contexts_.size(); ++i) {
+            for (auto value : contexts_[i]->slots_) {
+                WriteRef(value);
+            }
+        }
+    }
+
+private:
+    void AddSymbol(SymbolId id) {
+        if (symbol_ids_.emplace(id, symbols_.size()).second) {
+            symbols_.push_back(id);
+        }
+    }
+
+    void AddObject(Object* obj) {
+        if (obj == nullptr || obj == kUnboundSlot) {
+            return;
+        }
+        if (object_ids_.emplace(obj, objects_.size()).second) {
+            objects_.push_back(obj);
+        }
+    }
+
+    // Adds a frame after all of its parents.
+    void AddContext(Context* context) {
+        std::vector<Context*> chain;
+        for (; context != nullptr && !context_ids_.count(context); context = context->up_.get()) {
+            chain.push_back(context);
+        }
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            context_ids_.emplace(*it, contexts_.size());
+            contexts_.push_back(*it);
+            for (auto value : (*it)->slots_) {
+                AddObject(value);
+            }
+        }
+    }
+
+    std::optional<SymbolId> BuiltinId(Object* obj) {
+        if (!Is<Function>(obj)) {
+            return std::nullopt;
+        }
+        return FunctionRegistry::Instance().FindId(static_cast<Function*>(obj));
+    }
+
+    void Visit(Object* obj) {
+        if (auto id = BuiltinId(obj)) {
+            AddSymbol(*id);
+            return;
+        }
+        switch (obj->GetType()) {
+            case ObjectType::kNumber:
+            case ObjectType::kBigNum:
+            case ObjectType::kFlonum:
+            case ObjectType::kLambdaBuilder:
+                break;
+            case ObjectType::kSymbol:
+                AddSymbol(As<Symbol>(obj)->GetId());
+                break;
+            case ObjectType::kLocalVariable:
+                AddSymbol(static_cast<LocalVariable*>(obj)->GetId());
+                break;
+            case ObjectType::kCell:
+                AddObject(As<Cell>(obj)->GetFirst());
+                AddObject(As<Cell>(obj)->GetSecond());
+                break;
+            case ObjectType::kVector:
+                for (size_t i = 0; i < As<Vector>(obj)->Size(); ++i) {
+                    AddObject(As<Vector>(obj)->Get(i));
+                }
+                break;
+            case ObjectType::kHashTable:
+                As<HashTable>(obj)->ForEach([this](Object* key, Object* value) {
+                    AddObject(key);
+                    AddObject(value);
+                });
+                break;
+            case ObjectType::kCompiledCode:
+                for (auto constant : As<CompiledCode>(obj)->constants_) {
+                    AddObject(constant);
+                }
+                break;
+            case ObjectType::kLambda: {
+                auto lambda = As<LambdaFunction>(obj);
+                RuntimeAssert(lambda->context_ != nullptr);
+                AddContext(lambda->context_.get());
+                for (auto form : lambda->functions_) {
+                    AddObject(form);
+                }
+                AddObject(lambda->code_);
+                break;
+            }
+            default:
+                RuntimeAssert(false);
+        }
+    }
+
+    void WriteScalars(Object* obj) {
+        if (auto id = BuiltinId(obj)) {
+            WriteTag(ImageTag::kBuiltin);
+            WriteVarint(symbol_ids_.at(*id));
+            return;
+        }
+        switch (obj->GetType()) {
+            case ObjectType::kNumber: {
+                // Zigzag, so that small negative numbers stay short.
+                auto value = static_cast<uint64_t>(As<Number>(obj)->GetValue());
+                WriteTag(ImageTag::kNumber);
+                WriteVarint((value << 1) ^ (value >> 63 ? ~uint64_t(0) : 0));
+                break;
+            }
+            case ObjectType::kBigNum: {
+                const BigInteger& value = As<BigNum>(obj)->GetValue();
+                WriteTag(ImageTag::kBigNum);
+                WriteVarint(value.IsNegative());
+                WriteVarint(value.GetLimbs().size());
+                for (auto limb : value.GetLimbs()) {
+                    WriteVarint(limb);
+                }
+                break;
+            }
+            case ObjectType::kFlonum: {
+                // Bit pattern, which keeps NaN payloads and negative zero.
+                double value = As<Flonum>(obj)->GetValue();
+                uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                WriteTag(ImageTag::kFlonum);
+                WriteVarint(bits);
+                break;
+            }
+            case ObjectType::kSymbol:
+                WriteTag(ImageTag::kSymbol);
+                WriteVarint(symbol_ids_.at(As<Symbol>(obj)->GetId()));
+                break;
+            case ObjectType::kLocalVariable: {
+                auto variable = static_cast<LocalVariable*>(obj);
+                WriteTag(ImageTag::kLocalVariable);
+                WriteVarint(symbol_ids_.at(variable->GetId()));
+                WriteVarint(variable->GetDepth());
+                WriteVarint(variable->GetSlot());
+                break;
+            }
+            case ObjectType::kCell:
+                WriteTag(ImageTag::kCell);
+                break;
+            case ObjectType::kVector:
+                WriteTag(ImageTag::kVector);
+                WriteVarint(As<Vector>(obj)->Size());
+                break;
+            case ObjectType::kHashTable:
+                WriteTag(ImageTag::kHashTable);
+                WriteVarint(As<HashTable>(obj)->Size());
+                break;
+            case ObjectType::kCompiledCode: {
+                auto code = As<CompiledCode>(obj);
+                WriteTag(ImageTag::kCompiledCode);
+                WriteVarint(code->instructions_.size());
+                for (auto& instruction : code->instructions_) {
+                    WriteVarint(static_cast<uint64_t>(instruction.op));
+                    WriteVarint(instruction.a);
+                    WriteVarint(instruction.b);
+                }
+                WriteVarint(code->constants_.size());
+                break;
+            }
+            case ObjectType::kLambdaBuilder:
+                WriteTag(ImageTag::kLambdaBuilder);
+                WriteVarint(As<LambdaBuilderFunction>(obj)->GetFrameSize());
+                break;
+            case ObjectType::kLambda: {
+                auto lambda = As<LambdaFunction>(obj);
+                WriteTag(ImageTag::kLambda);
+                WriteVarint(lambda->arity_);
+                WriteVarint(lambda->frame_size_);
+                WriteVarint(lambda->functions_.size());
+                break;
+            }
+            default:
+                RuntimeAssert(false);
+        }
+    }
+
+    void WriteRefs(Object* obj) {
+        if (BuiltinId(obj)) {
+            return;
+        }
+        if (Is<Cell>(obj)) {
+            WriteRef(As<Cell>(obj)->GetFirst());
+            WriteRef(As<Cell>(obj)->GetSecond());
+        } else if (Is<Vector>(obj)) {
+            for (size_t i = 0; i < As<Vector>(obj)->Size(); ++i) {
+                WriteRef(As<Vector>(obj)->Get(i));
+            }
+        } else if (Is<HashTable>(obj)) {
+            As<HashTable>(obj)->ForEach([this](Object* key, Object* value) {
+                WriteRef(key);
+                WriteRef(value);
+            });
+        } else if (Is<CompiledCode>(obj)) {
+            for (auto constant : As<CompiledCode>(obj)->constants_) {
+                WriteRef(constant);
+            }
+        } else if (Is<LambdaFunction>(obj)) {
+            auto lambda = As<LambdaFunction>(obj);
+            WriteVarint(context_ids_.at(lambda->context_.get()));
+            for (auto form : lambda->functions_) {
+                WriteRef(form);
+            }
+            WriteRef(lambda->code_);
+        }
+    }
+
+    void WriteRef(Object* obj) {
+        if (obj == nullptr) {
+            WriteVarint(kNullRef);
+        } else if (obj == kUnboundSlot) {
+            WriteVarint(kUnboundRef);
+        } else {
+            WriteVarint(kFirstObjectRef + object_ids_.at(obj));
+        }
+    }
+
+    void WriteTag(ImageTag tag) {
+        out_->put(static_cast<char>(tag));
+    }
+
+    void WriteVarint(uint64_t value) {
+        char buffer[10];
+        size_t size = 0;
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            buffer[size++] = static_cast<char>(value ? byte | 0x80 : byte);
+        } while (value);
+        out_->write(buffer, size);
+    }
+
+private:
+    std::ostream* out_;
+    std::unordered_map<SymbolId, uint64_t> symbol_ids_;
+    std::vector<SymbolId> symbols_;
+    std::unordered_map<Object*, uint64_t> object_ids_;
+    std::vector<Object*> objects_;
+    std::unordered_map<Context*, uint64_t> context_ids_;
+    std::vector<Context*> contexts_;
+};
+
+class ImageReader {
+public:
+    ImageReader(std::string_view image, Context& global)
+        : image_(image), global_(global), heap_(global.GetHeap()) {
+    }
+
+    void Read() {
+        RuntimeAssert(image_.size() >= sizeof(kMagic) &&
+                      std::memcmp(image_.data(), kMagic, sizeof(kMagic)) == 0);
+        pos_ = sizeof(kMagic);
+        RuntimeAssert(ReadVarint() == kVersion);
+
+        symbols_.resize(ReadCount());
+        for (auto& id : symbols_) {
+            size_t size = ReadCount();
+            id = SymbolTable::Instance().Intern(image_.substr(pos_, size));
+            pos_ += size;
+        }
+
+        objects_.resize(ReadCount());
+        for (auto& obj : objects_) {
+            obj = ReadScalars();
+        }
+
+        contexts_.resize(ReadCount());
+        RuntimeAssert(!contexts_.empty());
+        contexts_[0] = global_.global_->shared_from_this();
+        for (size_t i = 1; i < contexts_.size(); ++i) {
+            size_t up = ReadVarint();
+            RuntimeAssert(up < i);
+            contexts_[i] = std::make_shared<Context>(contexts_[up], ReadCount());
+        }
+
+        for (auto obj : objects_) {
+            ReadRefs(obj);
+        }
+        // Before anything is defined, so that a bad image changes nothing.
+        for (auto obj : objects_) {
+            if (Is<CompiledCode>(obj)) {
+                CheckCode(As<CompiledCode>(obj));
+            }
+        }
+        for (auto& entry : table_entries_) {
+            entry.table->Set(entry.key, entry.value);
+        }
+
+        size_t globals = ReadCount();
+        for (size_t i = 0; i < globals; ++i) {
+            SymbolId id = ReadSymbol();
+            global_.AddVariable(id, ReadRef());
+        }
+
+        for (size_t i = 1; i < contexts_.size(); ++i) {
+            for (auto& value : contexts_[i]->slots_) {
+                value = ReadSlot();
+            }
+        }
+        RuntimeAssert(pos_ == image_.size());
+    }
+
+private:
+    Object* ReadScalars() {
+        RuntimeAssert(pos_ < image_.size());
+        auto tag = static_cast<ImageTag>(image_[pos_++]);
+        switch (tag) {
+            case ImageTag::kNumber: {
+                uint64_t value = ReadVarint();
+                return heap_->MakeInteger(static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1)));
+            }
+            case ImageTag::kBigNum: {
+                bool negative = ReadVarint();
+                std::vector<uint32_t> limbs(ReadCount());
+                for (auto& limb : limbs) {
+                    limb = ReadVarint();
+                }
+                return heap_->Make<BigNum>(BigInteger::FromLimbs(negative, std::move(limbs)));
+            }
+            case ImageTag::kFlonum: {
+                uint64_t bits = ReadVarint();
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return heap_->Make<Flonum>(value);
+            }
+            case ImageTag::kSymbol:
+                return heap_->InternSymbol(ReadSymbol());
+            case ImageTag::kLocalVariable: {
+                SymbolId id = ReadSymbol();
+                size_t depth = ReadVarint();
+                return heap_->Make<LocalVariable>(id, depth, ReadVarint());
+            }
+            case ImageTag::kCell:
+                return heap_->Make<Cell>();
+            case ImageTag::kVector:
+                return heap_->Make<Vector>(std::vector<Object*>(ReadCount()));
+            case ImageTag::kHashTable: {
+                auto table = heap_->Make<HashTable>(heap_);
+                table_sizes_.emplace(table, ReadCount());
+                return table;
+            }
+            case ImageTag::kCompiledCode: {
+                auto code = heap_->Make<CompiledCode>();
+                code->instructions_.resize(ReadCount());
+                for (auto& instruction : code->instructions_) {
+                    uint64_t op = ReadVarint();
+                    RuntimeAssert(op <= static_cast<uint64_t>(OpCode::kEvalTree));
+                    instruction.op = static_cast<OpCode>(op);
+                    instruction.a = ReadVarint();
+                    instruction.b = ReadVarint();
+                }
+                code->constants_.resize(ReadCount());
+                code->global_refs_.resize(code->constants_.size());
+                return code;
+            }
+            case ImageTag::kBuiltin: {
+                SymbolId id = ReadSymbol();
+                RuntimeAssert(FunctionRegistry::Instance().HasFunction(id));
+                return FunctionRegistry::Instance().GetFunction(id);
+            }
+            case ImageTag::kLambdaBuilder:
+                return heap_->Make<LambdaBuilderFunction>(ReadCount());
+            case ImageTag::kLambda: {
+                auto lambda = heap_->Make<LambdaFunction>();
+                lambda->arity_ = ReadVarint();
+                lambda->frame_size_ = ReadCount();
+                lambda->functions_.resize(ReadCount());
+                // The arguments are bound in the first slots, and the body
+                // ends in the form whose value is returned.
+                RuntimeAssert(lambda->arity_ <= lambda->frame_size_ &&
+                              !lambda->functions_.empty());
+                return lambda;
+            }
+        }
+        RuntimeAssert(false);
+        return nullptr;
+    }
+
+    void ReadRefs(Object* obj) {
+        if (Is<Cell>(obj)) {
+            As<Cell>(obj)->SetFirst(ReadRef());
+            As<Cell>(obj)->SetSecond(ReadRef());
+        } else if (Is<Vector>(obj)) {
+            for (size_t i = 0; i < As<Vector>(obj)->Size(); ++i) {
+                As<Vector>(obj)->Set(i, ReadRef());
+            }
+        } else if (Is<HashTable>(obj)) {
+            for (size_t i = 0; i < table_sizes_.at(As<HashTable>(obj)); ++i) {
+                Object* key = ReadRef();
+                table_entries_.push_back({As<HashTable>(obj), key, ReadRef()});
+            }
+        } else if (Is<CompiledCode>(obj)) {
+            for (auto& constant : As<CompiledCode>(obj)->constants_) {
+                constant = ReadRef();
+            }
+        } else if (Is<LambdaFunction>(obj)) {
+            auto lambda = As<LambdaFunction>(obj);
+            size_t context = ReadVarint();
+            RuntimeAssert(context < contexts_.size());
+            lambda->context_ = contexts_[context];
+            for (auto& form : lambda->functions_) {
+                form = ReadRef();
+            }
+            Object* code = ReadRef();
+            RuntimeAssert(code == nullptr || Is<CompiledCode>(code));
+            lambda->code_ = static_cast<CompiledCode*>(code);
+        }
+    }
+
+    Object* ReadRef() {
+        return GetObject(ReadVarint());
+    }
+
+    // The unbound marker is only valid in frame slots.
+    Object* ReadSlot() {
+        uint64_t ref = ReadVarint();
+        return ref == kUnboundRef ? kUnboundSlot : GetObject(ref);
+    }
+
+    Object* GetObject(uint64_t ref) {
+        if (ref == kNullRef) {
+            return nullptr;
+        }
+        RuntimeAssert(ref >= kFirstObjectRef && ref - kFirstObjectRef < objects_.size());
+        return objects_[ref - kFirstObjectRef];
+    }
+
+    // The VM trusts compiled code, so code from an image is checked like a
+    // bytecode verifier would: operands index the constant pool and the
+    // instructions, constants have the type their opcode expects, and every
+    // path keeps the same stack height at each instruction, never pops below
+    // the frame's base and ends in a return or tail call. Frame slots are
+    // checked by Context on access.
+    void CheckCode(CompiledCode* code) {
+        const auto& instructions = code->instructions_;
+        const auto& constants = code->constants_;
+        RuntimeAssert(!instructions.empty());
+        // Stack height on entry to each instruction, -1 until reached.
+        std::vector<int64_t> heights(instructions.size(), -1);
+        std::vector<size_t> pending;
+        auto flow = [&](uint64_t pc, int64_t height) {
+            RuntimeAssert(pc < instructions.size() && height >= 0);
+            if (heights[pc] < 0) {
+                heights[pc] = height;
+                pending.push_back(pc);
+            } else {
+                RuntimeAssert(heights[pc] == height);
+            }
+        };
+        auto constant = [&](uint32_t index) {
+            RuntimeAssert(index < constants.size());
+            return constants[index];
+        };
+        flow(0, 0);
+        while (!pending.empty()) {
+            size_t pc = pending.back();
+            pending.pop_back();
+            const Instruction& ins = instructions[pc];
+            int64_t height = heights[pc];
+            switch (ins.op) {
+                case OpCode::kConstant:
+                    constant(ins.a);
+                    flow(pc + 1, height + 1);
+                    break;
+                case OpCode::kLoadLocal:
+                    flow(pc + 1, height + 1);
+                    break;
+                case OpCode::kLoadGlobal:
+                case OpCode::kEvalTree:
+                    RuntimeAssert(constant(ins.a) != nullptr);
+                    flow(pc + 1, height + 1);
+                    break;
+                case OpCode::kCheckLocal:
+                    flow(pc + 1, height);
+                    break;
+                case OpCode::kCheckGlobal:
+                    RuntimeAssert(Is<Symbol>(constant(ins.a)));
+                    flow(pc + 1, height);
+                    break;
+                case OpCode::kStoreLocal:
+                    RuntimeAssert(height >= 1);
+                    flow(pc + 1, height);
+                    break;
+                case OpCode::kStoreGlobal:
+                    RuntimeAssert(height >= 1 && Is<Symbol>(constant(ins.a)));
+                    flow(pc + 1, height);
+                    break;
+                case OpCode::kPop:
+                    flow(pc + 1, height - 1);
+                    break;
+                case OpCode::kJump:
+                    flow(ins.a, height);
+                    break;
+                case OpCode::kJumpIfFalse:
+                    flow(ins.a, height - 1);
+                    flow(pc + 1, height - 1);
+                    break;
+                case OpCode::kJumpIfFalseKeep:
+                case OpCode::kJumpIfTrueKeep:
+                    RuntimeAssert(height >= 1);
+                    flow(ins.a, height);
+                    flow(pc + 1, height - 1);
+                    break;
+                case OpCode::kMakeClosure:
+                    RuntimeAssert(Is<LambdaFunction>(constant(ins.a)));
+                    flow(pc + 1, height + 1);
+                    break;
+                case OpCode::kCheckSpecial:
+                    RuntimeAssert(height >= 1 && Is<Cell>(constant(ins.a)));
+                    flow(ins.b, height);
+                    flow(pc + 1, height);
+                    break;
+                case OpCode::kCall:
+                    RuntimeAssert(height > ins.a);
+                    flow(pc + 1, height - ins.a);
+                    break;
+                case OpCode::kTailCall:
+                    RuntimeAssert(height > ins.a);
+                    break;
+                case OpCode::kReturn:
+                    RuntimeAssert(height >= 1);
+                    break;
+            }
+        }
+    }
+
+    SymbolId ReadSymbol() {
+        uint64_t index = ReadVarint();
+        RuntimeAssert(index < symbols_.size());
+        return symbols_[index];
+    }
+
+    // A count of items that each take at least one byte, which bounds
+    // allocations made for a corrupt image.
+    size_t ReadCount() {
+        uint64_t count = ReadVarint();
+        RuntimeAssert(count <= image_.size() - pos_);
+        return count;
+    }
+
+    uint64_t ReadVarint() {
+        uint64_t res = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            RuntimeAssert(pos_ < image_.size());
+            auto byte = static_cast<uint8_t>(image_[pos_++]);
+            res |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return res;
+            }
+        }
+        RuntimeAssert(false);
+        return 0;
+    }
+
+private:
+    std::string_view image_;
+    size_t pos_ = 0;
+    Context& global_;
+    Heap* heap_;
+    std::vector<SymbolId> symbols_;
+    std::vector<Object*> objects_;
+    std::vector<std::shared_ptr<Context>> contexts_;
+
+    struct TableEntry {
+        HashTable* table;
+        Object* key;
+        Object* value;
+    };
+    std::unordered_map<HashTable*, size_t> table_sizes_;
+    std::vector<TableEntry> table_entries_;
+};
+
+void SaveImage(Context& context, std::ostream* out) {
+    ImageWriter(out).Write(context);
+}
+
+void LoadImage(std::string_view image, Context& context) {
+    ImageReader(image, context).Read();
+}
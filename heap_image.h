@@ -0,0 +1,27 @@
+#pragma once
+
+#include "scheme_fwd.h"
+
+#include <ostream>
+#include <string_view>
+
+// Compact binary image of a global environment: its variables and every
+// object and closure frame reachable from them. Objects refer to each other
+// by index in the image, and loading relocates the indices to freshly
+// allocated objects, so an image can be loaded any number of times, into
+// any interpreter of the same build. Builtins and symbols are stored by
+// name.
+void SaveImage(Context& context, std::ostream* out);
+
+// Defines the variables of an image in the global environment of context,
+// replacing existing ones of the same name. Throws RuntimeError if the image
+// is malformed, and then defines nothing. Loading checks references,
+// builtin names and compiled code, and frame slots are checked on access,
+// so a corrupt image fails with errors rather than memory corruption. It
+// can still hold code that never terminates or recurses deeper than the
+// native stack, like any program, so images should come from a trusted
+// source.
+void LoadImage(std::string_view image, Context& context);
+
+class ImageWriter;
+class ImageReader;
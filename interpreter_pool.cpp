@@ -0,0 +1,180 @@
+#include "interpreter_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+InterpreterPool::InterpreterPool(size_t workers, Setup setup) {
+    workers = std::max<size_t>(workers, 1);
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // Started only once every queue exists, since workers steal from all.
+    std::vector<std::future<void>> ready;
+    for (size_t i = 0; i < workers; ++i) {
+        std::promise<void> promise;
+        ready.push_back(promise.get_future());
+        workers_[i]->thread =
+            std::thread(&InterpreterPool::WorkerLoop, this, i, setup, std::move(promise));
+    }
+    std::exception_ptr error;
+    for (auto& future : ready) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        // The destructor does not run for a constructor that throws.
+        Stop();
+        std::rethrow_exception(error);
+    }
+}
+
+InterpreterPool::~InterpreterPool() {
+    Stop();
+}
+
+void InterpreterPool::Stop() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+std::future<std::string> InterpreterPool::Submit(std::string request) {
+    std::vector<Task> tasks(1);
+    tasks[0].request = std::move(request);
+    tasks[0].submitted = std::chrono::steady_clock::now();
+    auto res = tasks[0].result.get_future();
+    Push(next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size(), &tasks);
+    return res;
+}
+
+// Deals the batch out in contiguous runs, one per worker, so that each
+// queue is locked once; stealing evens out runs of uneven cost.
+std::vector<std::future<std::string>> InterpreterPool::SubmitBatch(
+    std::vector<std::string> requests) {
+    std::vector<std::future<std::string>> res;
+    res.reserve(requests.size());
+    auto now = std::chrono::steady_clock::now();
+    size_t count = workers_.size();
+    size_t first = next_worker_.fetch_add(1, std::memory_order_relaxed);
+    size_t begin = 0;
+    for (size_t i = 0; i < count && begin < requests.size(); ++i) {
+        size_t end = begin + (requests.size() - begin) / (count - i);
+        end = std::max(end, begin + 1);
+        std::vector<Task> tasks(end - begin);
+        for (size_t j = begin; j < end; ++j) {
+            Task& task = tasks[j - begin];
+            task.request = std::move(requests[j]);
+            task.submitted = now;
+            res.push_back(task.result.get_future());
+        }
+        Push((first + i) % count, &tasks);
+        begin = end;
+    }
+    return res;
+}
+
+PoolStats InterpreterPool::GetStats() const {
+    LatencyHistogram latency;
+    for (auto& worker : workers_) {
+        latency.Merge(worker->latency);
+    }
+    PoolStats stats;
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    stats.stolen = stolen_.load(std::memory_order_relaxed);
+    stats.p50 = latency.Percentile(0.5);
+    stats.p90 = latency.Percentile(0.9);
+    stats.p99 = latency.Percentile(0.99);
+    stats.p999 = latency.Percentile(0.999);
+    return stats;
+}
+
+void InterpreterPool::Push(size_t worker, std::vector<Task>* tasks) {
+    {
+        std::lock_guard lock(workers_[worker]->mutex);
+        for (auto& task : *tasks) {
+            workers_[worker]->queue.push_back(std::move(task));
+        }
+    }
+    {
+        std::lock_guard lock(wake_mutex_);
+        pending_ += tasks->size();
+    }
+    if (tasks->size() == 1) {
+        wake_.notify_one();
+    } else {
+        wake_.notify_all();
+    }
+}
+
+bool InterpreterPool::Pop(size_t worker, Task* task) {
+    std::lock_guard lock(workers_[worker]->mutex);
+    auto& queue = workers_[worker]->queue;
+    if (queue.empty()) {
+        return false;
+    }
+    *task = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+bool InterpreterPool::Steal(size_t thief, Task* task) {
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker& victim = *workers_[(thief + i) % workers_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.queue.empty()) {
+            *task = std::move(victim.queue.back());
+            victim.queue.pop_back();
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void InterpreterPool::WorkerLoop(size_t index, const Setup& setup, std::promise<void> ready) {
+    Interpreter interpreter;
+    try {
+        if (setup) {
+            setup(interpreter);
+        }
+    } catch (...) {
+        ready.set_exception(std::current_exception());
+        return;
+    }
+    ready.set_value();
+    Worker& worker = *workers_[index];
+    while (true) {
+        Task task;
+        if (Pop(index, &task) || Steal(index, &task)) {
+            {
+                std::lock_guard lock(wake_mutex_);
+                --pending_;
+            }
+            try {
+                task.result.set_value(interpreter.Run(task.request));
+                completed_.fetch_add(1, std::memory_order_relaxed);
+            } catch (...) {
+                task.result.set_exception(std::current_exception());
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            worker.latency.Record(std::chrono::steady_clock::now() - task.submitted);
+            continue;
+        }
+        std::unique_lock lock(wake_mutex_);
+        wake_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+        if (stopping_ && pending_ == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "latency_histogram.h"
+#include "scheme.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PoolStats {
+    size_t completed = 0;
+    size_t failed = 0;
+    size_t stolen = 0;
+    // Time from submission to completion of a request.
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds p999{0};
+};
+
+// Fixed set of worker threads, each owning one Interpreter that only it
+// touches. Requests go to the workers' queues round-robin, and an idle
+// worker steals from the far end of a busy one's queue, so a request may
+// run on any interpreter: requests must not depend on each other's side
+// effects. Definitions every request needs belong in the setup callback,
+// which runs on each interpreter before it serves requests.
+class InterpreterPool {
+public:
+    using Setup = std::function<void(Interpreter&)>;
+
+    // Returns once setup has run on every interpreter. If it throws on any
+    // of them, the workers are stopped and the first exception is rethrown.
+    explicit InterpreterPool(size_t workers, Setup setup = nullptr);
+    InterpreterPool(const InterpreterPool&) = delete;
+    InterpreterPool& operator=(const InterpreterPool&) = delete;
+    // Finishes every submitted request before returning.
+    ~InterpreterPool();
+
+    // The future holds the printed result or the error Run threw.
+    std::future<std::string> Submit(std::string request);
+    std::vector<std::future<std::string>> SubmitBatch(std::vector<std::string> requests);
+
+    size_t GetWorkerCount() const {
+        return workers_.size();
+    }
+
+    PoolStats GetStats() const;
+
+private:
+    struct Task {
+        std::string request;
+        std::promise<std::string> result;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        // The owner takes from the front, thieves from the back.
+        std::deque<Task> queue;
+        LatencyHistogram latency;
+        std::thread thread;
+    };
+
+    void Push(size_t worker, std::vector<Task>* tasks);
+    bool Pop(size_t worker, Task* task);
+    bool Steal(size_t thief, Task* task);
+    void WorkerLoop(size_t index, const Setup& setup, std::promise<void> ready);
+    void Stop();
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_{0};
+
+    // Guards pending_ and stopping_, so that a worker cannot miss the
+    // wake-up for a task pushed between its last look and its wait.
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    size_t pending_ = 0;
+    bool stopping_ = false;
+
+    std::atomic<size_t> completed_{0};
+    std::atomic<size_t> failed_{0};
+    std::atomic<size_t> stolen_{0};
+};
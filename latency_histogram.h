@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear histogram of durations: every power of two is split into
+// eight buckets, so a percentile is reported with at most 12.5% error in
+// fixed memory. Recording is a relaxed atomic increment and may race with
+// readers, which then see a slightly stale distribution.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    void Record(std::chrono::nanoseconds duration) {
+        uint64_t value = duration.count() > 0 ? duration.count() : 0;
+        counts_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            counts_[i].fetch_add(other.counts_[i].load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t Count() const {
+        uint64_t res = 0;
+        for (auto& count : counts_) {
+            res += count.load(std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    // Upper bound of the bucket holding the given fraction of the samples,
+    // zero if nothing was recorded.
+    std::chrono::nanoseconds Percentile(double fraction) const {
+        uint64_t total = Count();
+        if (total == 0) {
+            return std::chrono::nanoseconds(0);
+        }
+        auto rank = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::chrono::nanoseconds(UpperBound(i));
+            }
+        }
+        return std::chrono::nanoseconds(UpperBound(kBuckets - 1));
+    }
+
+private:
+    static size_t BucketOf(uint64_t value) {
+        if (value < kSubBuckets) {
+            return value;
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        uint64_t sub = (value >> (exponent - kSubBits)) & (kSubBuckets - 1);
+        return (exponent - kSubBits + 1) * kSubBuckets + sub;
+    }
+
+    static int64_t UpperBound(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        int shift = bucket / kSubBuckets - 1;
+        uint64_t lower = (kSubBuckets + bucket % kSubBuckets) << shift;
+        uint64_t res = lower + (uint64_t(1) << shift) - 1;
+        return res > INT64_MAX ? INT64_MAX : static_cast<int64_t>(res);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+};
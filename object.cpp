@@ -1,535 +1,1369 @@
 #include "object.h"
+#include "bytecode.h"
+#include "hash_table.h"
+#include "parallel.h"
+
+#include <charconv>
+#include <cmath>
+#include <unordered_map>
 
 namespace {
 
 template <typename T>
 T *MakeObject(Context &context) {
-    std::shared_ptr<T> res = std::make_shared<T>();
-    context.AddPtrToData(res);
-    return res.get();
+    return context.GetHeap()->Make<T>();
 }
 
 Number *MakeSharedNumber(int64_t number, Context &context) {
-    std::shared_ptr<Number> res = std::make_shared<Number>(number);
-    context.AddPtrToData(res);
-    return As<Number>(res.get());
+    return context.GetHeap()->MakeInteger(number);
 }
 
-}  // namespace
+bool IsVariable(Object *obj) {
+    return Is<Symbol>(obj) || Is<LocalVariable>(obj);
+}
 
-Function *GetBooleanFunction(bool boolean, Context &context) {
-    if (boolean) {
-        return MakeObject<True>(context);
+// Symbols left in place by the analyzer name globals, LocalVariable nodes
+// name frame slots.
+bool IsBoundVariable(Object *variable, Context &context) {
+    if (Is<LocalVariable>(variable)) {
+        return As<LocalVariable>(variable)->IsBound(context);
+    }
+    return context.HasVariable(As<Symbol>(variable)->GetId());
+}
+
+void AssignVariable(Object *variable, Object *value, Context &context) {
+    if (Is<LocalVariable>(variable)) {
+        As<LocalVariable>(variable)->Assign(value, context);
     } else {
-        return MakeObject<False>(context);
+        context.AddVariable(As<Symbol>(variable)->GetId(), value);
     }
 }
 
-bool ToBool(Object *func) {
-    if ((Is<Symbol>(func) && As<Symbol>(func)->GetName() == "#f") || Is<False>(func)) {
-        return false;
+bool IsInteger(Object *obj) {
+    return Is<Number>(obj) || Is<BigNum>(obj);
+}
+
+BigInteger ToBigInteger(Object *obj) {
+    RuntimeAssert(IsInteger(obj));
+    if (Is<Number>(obj)) {
+        return BigInteger(As<Number>(obj)->GetValue());
+    }
+    return As<BigNum>(obj)->GetValue();
+}
+
+// Results in the int64_t range are always Numbers.
+Object *MakeInteger(BigInteger value, Context &context) {
+    if (value.FitsInt64()) {
+        return MakeSharedNumber(value.ToInt64(), context);
+    }
+    return context.GetHeap()->Make<BigNum>(std::move(value));
+}
+
+bool IsNumber(Object *obj) {
+    return IsInteger(obj) || Is<Flonum>(obj);
+}
+
+double ToDouble(Object *obj) {
+    RuntimeAssert(IsNumber(obj));
+    if (Is<Number>(obj)) {
+        return static_cast<double>(As<Number>(obj)->GetValue());
+    }
+    if (Is<BigNum>(obj)) {
+        return As<BigNum>(obj)->GetValue().ToDouble();
+    }
+    return As<Flonum>(obj)->GetValue();
+}
+
+Flonum *MakeFlonum(double value, Context &context) {
+    return context.GetHeap()->Make<Flonum>(value);
+}
+
+// Negative, zero or positive as lhs is less than, equal to or greater than
+// rhs.
+int CompareIntegers(Object *lhs, Object *rhs) {
+    if (Is<Number>(lhs) && Is<Number>(rhs)) {
+        int64_t a = As<Number>(lhs)->GetValue();
+        int64_t b = As<Number>(rhs)->GetValue();
+        return (a > b) - (a < b);
+    }
+    return Compare(ToBigInteger(lhs), ToBigInteger(rhs));
+}
+
+// Compares exactly, without rounding the integer to a double first; lhs
+// must not be NaN.
+int CompareFlonumInteger(double lhs, Object *rhs) {
+    // Integers of up to 53 bits convert to doubles exactly.
+    constexpr int64_t kMaxExact = int64_t(1) << 53;
+    if (Is<Number>(rhs) && -kMaxExact <= As<Number>(rhs)->GetValue() &&
+        As<Number>(rhs)->GetValue() <= kMaxExact) {
+        double b = static_cast<double>(As<Number>(rhs)->GetValue());
+        return (lhs > b) - (lhs < b);
+    }
+    if (std::isinf(lhs)) {
+        return lhs > 0 ? 1 : -1;
+    }
+    double whole = std::trunc(lhs);
+    if (int cmp = Compare(BigInteger::FromDouble(whole), ToBigInteger(rhs)); cmp != 0) {
+        return cmp;
+    }
+    return (lhs > whole) - (lhs < whole);
+}
+
+int CompareNumbers(Object *lhs, Object *rhs) {
+    if (IsInteger(lhs) && IsInteger(rhs)) {
+        return CompareIntegers(lhs, rhs);
+    }
+    if (Is<Flonum>(lhs) && Is<Flonum>(rhs)) {
+        double a = As<Flonum>(lhs)->GetValue();
+        double b = As<Flonum>(rhs)->GetValue();
+        return (a > b) - (a < b);
+    }
+    if (Is<Flonum>(lhs)) {
+        return CompareFlonumInteger(As<Flonum>(lhs)->GetValue(), rhs);
+    }
+    return -CompareFlonumInteger(As<Flonum>(rhs)->GetValue(), lhs);
+}
+
+bool IsNaN(Object *obj) {
+    return Is<Flonum>(obj) && std::isnan(As<Flonum>(obj)->GetValue());
+}
+
+// Whether pred holds for the comparison of every two adjacent arguments,
+// all of which must be numbers. Nothing is ordered with NaN.
+template <class Pred>
+bool IsMonotone(const Arguments &args, Pred pred) {
+    bool res = true;
+    for (size_t i = 0; i < args.Size(); ++i) {
+        RuntimeAssert(IsNumber(args[i]));
+        if (IsNaN(args[i])) {
+            res = false;
+        } else if (i > 0 && res) {
+            res = pred(CompareNumbers(args[i - 1], args[i]));
+        }
+    }
+    return res;
+}
+
+// Continues a fold from args[i] on with flonum_op, accumulating in a plain
+// double so that only the result is boxed.
+template <class FlonumOp>
+Object *FoldFlonum(const Arguments &args, size_t i, double acc, FlonumOp flonum_op,
+                   Context &context) {
+    for (; i < args.Size(); ++i) {
+        acc = flonum_op(acc, ToDouble(args[i]));
+    }
+    return MakeFlonum(acc, context);
+}
+
+// Folds args[first..] into init. While everything fits, the fold runs on
+// int64_t with fixnum_op, which returns true on overflow like the
+// __builtin_*_overflow functions; from the first overflow or BigNum on it
+// continues with big_op on BigIntegers, and from the first Flonum on with
+// flonum_op on doubles.
+template <class FixnumOp, class BigOp, class FlonumOp>
+Object *FoldNumber(const Arguments &args, size_t first, Object *init, FixnumOp fixnum_op,
+                   BigOp big_op, FlonumOp flonum_op, Context &context) {
+    RuntimeAssert(IsNumber(init));
+    size_t i = first;
+    if (Is<Flonum>(init)) {
+        return FoldFlonum(args, i, As<Flonum>(init)->GetValue(), flonum_op, context);
+    }
+    BigInteger big;
+    if (Is<Number>(init)) {
+        int64_t acc = As<Number>(init)->GetValue();
+        for (; i < args.Size(); ++i) {
+            int64_t next;
+            if (!Is<Number>(args[i]) || fixnum_op(acc, As<Number>(args[i])->GetValue(), &next)) {
+                break;
+            }
+            acc = next;
+        }
+        if (i == args.Size()) {
+            return MakeSharedNumber(acc, context);
+        }
+        if (Is<Flonum>(args[i])) {
+            return FoldFlonum(args, i, static_cast<double>(acc), flonum_op, context);
+        }
+        big = BigInteger(acc);
+    } else {
+        big = ToBigInteger(init);
+    }
+    for (; i < args.Size(); ++i) {
+        if (Is<Flonum>(args[i])) {
+            return FoldFlonum(args, i, big.ToDouble(), flonum_op, context);
+        }
+        big = big_op(big, ToBigInteger(args[i]));
+    }
+    return MakeInteger(std::move(big), context);
+}
+
+// The winning argument by pred(CompareNumbers(arg, best)), as a Flonum if
+// any argument is one.
+template <class Pred>
+Object *SelectNumber(const Arguments &args, Pred pred, Context &context) {
+    RuntimeAssert(args.Size() >= 1 && IsNumber(args[0]));
+    Object *res = args[0];
+    bool inexact = Is<Flonum>(res);
+    for (size_t i = 1; i < args.Size(); ++i) {
+        RuntimeAssert(IsNumber(args[i]));
+        inexact = inexact || Is<Flonum>(args[i]);
+        if (IsNaN(args[i]) || (!IsNaN(res) && pred(CompareNumbers(args[i], res)))) {
+            res = args[i];
+        }
+    }
+    if (inexact && !Is<Flonum>(res)) {
+        return MakeFlonum(ToDouble(res), context);
+    }
+    return res;
+}
+
+// Follows pos cdrs of lst; a negative pos wraps around and runs off the end.
+Object *DropElements(Object *lst, Object *pos) {
+    RuntimeAssert(Is<Cell>(lst) && Is<Number>(pos));
+    size_t count = As<Number>(pos)->GetValue();
+    for (size_t i = 0; i < count; ++i) {
+        RuntimeAssert(Is<Cell>(lst));
+        lst = As<Cell>(lst)->GetSecond();
+    }
+    return lst;
+}
+
+// Checks that index is a valid position in vector.
+size_t VectorIndex(Vector *vector, Object *index) {
+    RuntimeAssert(Is<Number>(index) && As<Number>(index)->GetValue() >= 0 &&
+                  static_cast<uint64_t>(As<Number>(index)->GetValue()) < vector->Size());
+    return As<Number>(index)->GetValue();
+}
+
+// Whether none of the lists in rests has ended; each must be a proper list.
+bool AllPairs(const std::vector<Object *> &rests) {
+    for (auto rest : rests) {
+        if (rest == nullptr) {
+            return false;
+        }
+        RuntimeAssert(Is<Cell>(rest));
     }
     return true;
 }
 
-List ParseToList(Cell *obj) {
-    if (obj == nullptr) {
-        return List();
+// Pushes the car of every list in rests onto the evaluator stack and
+// advances the lists to their cdrs.
+void PushCars(std::vector<Object *> *rests, Heap *heap) {
+    for (auto &rest : *rests) {
+        heap->PushRoot(As<Cell>(rest)->GetFirst());
+        rest = As<Cell>(rest)->GetSecond();
     }
-    List result;
-    std::vector<Object *> &list = result.objects;
-    if (obj->GetFirst()) {
-        list.push_back(obj->GetFirst());
+}
+
+// Calls func with the top size values of the evaluator stack as arguments
+// and pops them; the values stay rooted during the call.
+Object *ApplyFromStack(Object *func, size_t size, Context &context) {
+    RuntimeAssert(Is<Function>(func));
+    std::vector<Object *> &stack = context.GetHeap()->GetStack();
+    size_t begin = stack.size() - size;
+    Object *res = As<Function>(func)->Apply(Arguments(&stack, begin, size), context);
+    stack.resize(begin);
+    return res;
+}
+
+// The lists in args[first..], which stay rooted through args.
+std::vector<Object *> GetLists(const Arguments &args, size_t first) {
+    std::vector<Object *> rests;
+    for (size_t i = first; i < args.Size(); ++i) {
+        rests.push_back(args[i]);
     }
-    while (obj->GetSecond() && Is<Cell>(obj->GetSecond())) {
-        obj = As<Cell>(obj->GetSecond());
-        list.push_back(obj->GetFirst());
+    return rests;
+}
+
+// Fewest list elements worth a thread of their own in pmap and preduce.
+constexpr size_t kMinParallelChunk = 32;
+
+// A contiguous run of list elements handled by one pmap or preduce worker,
+// with the heap its allocations live in until the results are copied out.
+struct ParallelChunk {
+    size_t begin = 0;
+    size_t end = 0;
+    Heap heap;
+    std::shared_ptr<Context> context = std::make_shared<Context>();
+    std::vector<Object *> results;
+};
+
+// Calls nested in a worker already have the threads to themselves, so they
+// keep to the calling one rather than multiplying them.
+std::vector<std::unique_ptr<ParallelChunk>> SplitIntoChunks(size_t size, Heap *heap) {
+    size_t count = heap->IsWorkerMode()
+                       ? 1
+                       : std::clamp<size_t>(size / kMinParallelChunk, 1, GetParallelism());
+    std::vector<std::unique_ptr<ParallelChunk>> chunks;
+    for (size_t i = 0; i < count; ++i) {
+        auto chunk = std::make_unique<ParallelChunk>();
+        chunk->begin = size * i / count;
+        chunk->end = size * (i + 1) / count;
+        chunk->heap.SetWorkerMode();
+        chunk->context->SetHeap(&chunk->heap);
+        chunks.push_back(std::move(chunk));
     }
-    if (obj->GetSecond()) {
-        result.is_wrong = true;
-        list.push_back(obj->GetSecond());
+    return chunks;
+}
+
+std::vector<Object *> ListElements(Object *list) {
+    std::vector<Object *> elements;
+    for (Object *rest = list; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+        RuntimeAssert(Is<Cell>(rest));
+        elements.push_back(As<Cell>(rest)->GetFirst());
     }
-    return result;
+    return elements;
 }
 
-Cell *ParseToCell(List &list, Context &context) {
-    Cell *result = MakeObject<Cell>(context);
-    std::vector<Object *> &objects = list.objects;
-    if (objects.empty()) {
-        return result;
-    }
-    auto now = result;
-    for (size_t i = 0; i < objects.size(); ++i) {
-        if (i + 1 == objects.size() && list.is_wrong) {
-            now->SetSecond(objects[i]);
-        } else {
-            Cell *cell = MakeObject<Cell>(context);
-            cell->SetFirst(objects[i]);
-            now->SetSecond(cell);
-            now = cell;
+bool OwnedByWorker(Object *obj, const std::vector<std::unique_ptr<ParallelChunk>> &chunks) {
+    for (auto &chunk : chunks) {
+        if (chunk->heap.Owns(obj)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copies the objects of a worker's result that the workers allocated into
+// heap. Objects of the calling interpreter, builtins among them, are kept
+// as they are, so results keep their identity; procedures created by a
+// worker may close over its frames and are refused. Vectors and hash
+// tables are the only aggregates that can be cyclic, copies maps them to
+// their copies.
+Object *CopyToHeap(Object *obj, const std::vector<std::unique_ptr<ParallelChunk>> &chunks,
+                   Heap *heap, std::unordered_map<Object *, Object *> *copies) {
+    if (obj == nullptr || !OwnedByWorker(obj, chunks)) {
+        return obj;
+    }
+    if (Is<Number>(obj)) {
+        return heap->MakeInteger(As<Number>(obj)->GetValue());
+    }
+    if (Is<BigNum>(obj)) {
+        return heap->Make<BigNum>(As<BigNum>(obj)->GetValue());
+    }
+    if (Is<Flonum>(obj)) {
+        return heap->Make<Flonum>(As<Flonum>(obj)->GetValue());
+    }
+    if (Is<Symbol>(obj)) {
+        return heap->InternSymbol(As<Symbol>(obj)->GetId());
+    }
+    if (Is<Cell>(obj)) {
+        Cell *head = nullptr;
+        Cell *last = nullptr;
+        // A tail read from the calling interpreter is shared, not copied.
+        for (; Is<Cell>(obj) && OwnedByWorker(obj, chunks); obj = As<Cell>(obj)->GetSecond()) {
+            Cell *cell = heap->Make<Cell>();
+            cell->SetFirst(CopyToHeap(As<Cell>(obj)->GetFirst(), chunks, heap, copies));
+            if (last == nullptr) {
+                head = cell;
+            } else {
+                last->SetSecond(cell);
+            }
+            last = cell;
         }
+        last->SetSecond(CopyToHeap(obj, chunks, heap, copies));
+        return head;
+    }
+    if (Is<Vector>(obj)) {
+        if (auto it = copies->find(obj); it != copies->end()) {
+            return it->second;
+        }
+        auto vector = As<Vector>(obj);
+        auto copy = heap->Make<Vector>(std::vector<Object *>(vector->Size()));
+        copies->emplace(obj, copy);
+        for (size_t i = 0; i < vector->Size(); ++i) {
+            copy->Set(i, CopyToHeap(vector->Get(i), chunks, heap, copies));
+        }
+        return copy;
+    }
+    if (Is<HashTable>(obj)) {
+        if (auto it = copies->find(obj); it != copies->end()) {
+            return it->second;
+        }
+        auto copy = heap->Make<HashTable>(heap);
+        copies->emplace(obj, copy);
+        As<HashTable>(obj)->ForEach([&](Object *key, Object *value) {
+            copy->Set(CopyToHeap(key, chunks, heap, copies),
+                      CopyToHeap(value, chunks, heap, copies));
+        });
+        return copy;
+    }
+    // A procedure created by a worker.
+    RuntimeAssert(false);
+    return nullptr;
+}
+
+// Call forms in tail position are handed back to the loop in Cell::Eval;
+// anything else cannot nest evaluation and is evaluated right away.
+Object *EvalInTail(Object *form, Context &context, TailCall *tail) {
+    RuntimeAssert(form != nullptr);
+    if (Is<Cell>(form)) {
+        tail->form = form;
+        return nullptr;
+    }
+    return form->Eval(context);
+}
+
+// Evaluates what EvalTail or ApplyTail left pending, for callers that need
+// the value itself.
+Object *FinishTailCall(Object *res, TailCall *tail, Context &context) {
+    if (tail->form == nullptr) {
+        return res;
+    }
+    if (!tail->frame) {
+        return tail->form->Eval(context);
+    }
+    Heap::FrameGuard frame(context.GetHeap(), std::move(tail->frame));
+    return tail->form->Eval(*frame);
+}
+
+}  // namespace
+
+// Identity, except that numbers are compared by value since only small
+// integers are unique objects. An integer is never eqv to a Flonum.
+bool IsEqv(Object *lhs, Object *rhs) {
+    if (lhs == rhs) {
+        return true;
+    }
+    if (IsInteger(lhs) && IsInteger(rhs)) {
+        return CompareIntegers(lhs, rhs) == 0;
+    }
+    if (Is<Flonum>(lhs) && Is<Flonum>(rhs)) {
+        return As<Flonum>(lhs)->GetValue() == As<Flonum>(rhs)->GetValue();
+    }
+    return false;
+}
+
+// Structural equality of lists and vectors; recurses on cars and element
+// values, iterates along cdrs.
+bool IsEqual(Object *lhs, Object *rhs) {
+    while (Is<Cell>(lhs) && Is<Cell>(rhs)) {
+        if (!IsEqual(As<Cell>(lhs)->GetFirst(), As<Cell>(rhs)->GetFirst())) {
+            return false;
+        }
+        lhs = As<Cell>(lhs)->GetSecond();
+        rhs = As<Cell>(rhs)->GetSecond();
+    }
+    if (Is<Vector>(lhs) && Is<Vector>(rhs)) {
+        auto a = As<Vector>(lhs);
+        auto b = As<Vector>(rhs);
+        if (a->Size() != b->Size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a->Size(); ++i) {
+            if (!IsEqual(a->Get(i), b->Get(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return IsEqv(lhs, rhs);
+}
+
+Function *GetBooleanFunction(bool boolean, Context &context) {
+    // #t and #f are registered builtins, so the result is one of two objects.
+    return FunctionRegistry::Instance().GetFunction(boolean ? SymbolTable::kTrue
+                                                            : SymbolTable::kFalse);
+}
+
+bool ToBool(Object *func) {
+    if ((Is<Symbol>(func) && As<Symbol>(func)->GetId() == SymbolTable::kFalse) || Is<False>(func)) {
+        return false;
+    }
+    return true;
+}
+
+List ParseToList(Cell *obj) {
+    List result;
+    for (ListIterator it(obj); !it.AtEnd(); ++it) {
+        result.is_wrong = it.IsTail();
+        result.objects.push_back(*it);
     }
     return result;
 }
 
+size_t PushList(Cell *list, Heap *heap) {
+    size_t size = 0;
+    for (ListIterator it(list); !it.AtEnd(); ++it, ++size) {
+        heap->PushRoot(*it);
+    }
+    return size;
+}
+
 Object *Symbol::Eval(Context &context) {
     auto &instance = FunctionRegistry::Instance();
-    if (name_ == "#t") {
-        return MakeObject<True>(context);
+    if (instance.HasFunction(id_) && !instance.IsLibraryFunction(id_)) {
+        return instance.GetFunction(id_);
     }
-    if (name_ == "#f") {
-        return MakeObject<False>(context);
+    if (context.HasVariable(id_)) {
+        return context.GetVariable(id_);
     }
-    if (instance.HasFunction(name_)) {
-        return instance.GetFunction(name_, context);
-    }
-    NameAssert(context.HasVariable(name_));
-    return context.GetVariable(name_);
+    NameAssert(instance.HasFunction(id_));
+    return instance.GetFunction(id_);
+}
+
+Object *LocalVariable::Eval(Context &context) {
+    Object *value = context.GetSlot(depth_, slot_);
+    NameAssert(value != kUnboundSlot);
+    return value;
 }
 
 Object *Cell::Eval(Context &context) {
-    List list = ParseToList(As<Cell>(this));
-    std::vector<Object *> &args = list.objects;
-    RuntimeAssert(!args.empty());
-    args[0] = args.front()->Eval(context);
-    RuntimeAssert(Is<Function>(args.front()));
-    return As<Function>(list.objects[0])->Eval(list, context);
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    std::vector<Object *> &stack = heap->GetStack();
+    size_t form_slot = stack.size();
+    heap->PushRoot(this);
+    // Frame of the lambda whose body form is being evaluated in tail position.
+    Heap::FrameGuard frame(heap);
+    Context *current = &context;
+    Object *form = this;
+    while (true) {
+        heap->MaybeCollect();
+        // The form's elements go on the stack, the head replaced by its value.
+        size_t begin = stack.size();
+        size_t size = PushList(As<Cell>(form), heap);
+        RuntimeAssert(size > 0 && stack[begin] != nullptr);
+        Object *head = stack[begin]->Eval(*current);
+        RuntimeAssert(Is<Function>(head));
+        stack[begin] = head;
+        TailCall tail;
+        Object *res = As<Function>(head)->EvalTail(Arguments(&stack, begin, size), *current, &tail);
+        if (tail.form == nullptr) {
+            return res;
+        }
+        if (tail.frame) {
+            frame.Reset(std::move(tail.frame));
+            current = &*frame;
+        }
+        form = tail.form;
+        stack.resize(form_slot + 1);
+        stack[form_slot] = form;
+    }
 }
 
 Object *Function::Eval(Context &context) {
-    RuntimeAssert(false);
-    return nullptr;
+    // Builtins resolved by the analyzer sit in the tree as themselves.
+    return this;
 };
 
 void Function::Print(std::ostream *out) {
     RuntimeAssert(false);
 }
 
+Object *Function::Eval(const Arguments &args, Context &context) {
+    TailCall tail;
+    Object *res = EvalTail(args, context, &tail);
+    return FinishTailCall(res, &tail, context);
+}
+
+Object *Function::EvalTail(const Arguments &args, Context &context, TailCall *tail) {
+    if (IsSpecialForm()) {
+        return Eval(args, context);
+    }
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    std::vector<Object *> &stack = heap->GetStack();
+    size_t begin = stack.size();
+    for (size_t i = 1; i < args.Size(); ++i) {
+        RuntimeAssert(args[i] != nullptr);
+        heap->PushRoot(args[i]->Eval(context));
+    }
+    return ApplyTail(Arguments(&stack, begin, stack.size() - begin), context, tail);
+}
+
+Object *Function::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(false);
+    return nullptr;
+}
+
+Object *Function::ApplyTail(const Arguments &args, Context &context, TailCall *tail) {
+    return Apply(args, context);
+}
+
+void Flonum::Print(std::ostream *out) {
+    if (std::isnan(value_)) {
+        (*out) << "+nan.0";
+        return;
+    }
+    if (std::isinf(value_)) {
+        (*out) << (value_ > 0 ? "+inf.0" : "-inf.0");
+        return;
+    }
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value_);
+    std::string_view text(buffer, end - buffer);
+    (*out) << text;
+    // Integral values still read back as flonums.
+    if (text.find_first_of(".e") == std::string_view::npos) {
+        (*out) << ".0";
+    }
+}
+
 void Cell::Print(std::ostream *out) {
     (*out) << "(";
-    auto list = ParseToList(As<Cell>(this));
-    for (size_t i = 0; i < list.objects.size(); ++i) {
-        if (!list.objects[i]) {
-            continue;
+    bool first = true;
+    for (ListIterator it(this); !it.AtEnd(); ++it) {
+        if (!first) {
+            (*out) << " ";
         }
+        first = false;
+        if (it.IsTail()) {
+            (*out) << ". ";
+        }
+        if (*it) {
+            (*it)->Print(out);
+        } else {
+            (*out) << "()";
+        }
+    }
+    (*out) << ")";
+}
+
+void Vector::Print(std::ostream *out) {
+    (*out) << "#(";
+    for (size_t i = 0; i < elements_.size(); ++i) {
         if (i > 0) {
             (*out) << " ";
         }
-        if (i + 1 == list.objects.size() && list.is_wrong) {
-            (*out) << ". ";
+        if (elements_[i]) {
+            elements_[i]->Print(out);
+        } else {
+            (*out) << "()";
         }
-        list.objects[i]->Print(out);
     }
     (*out) << ")";
 }
 
-Object *True::Eval(const List &list, Context &context) {
+Object *True::Eval(const Arguments &args, Context &context) {
     RuntimeAssert(false);
     return nullptr;
 }
 
-Object *False::Eval(const List &list, Context &context) {
+Object *False::Eval(const Arguments &args, Context &context) {
     RuntimeAssert(false);
     return nullptr;
 }
 
-Object *QuoteFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() <= 2);
+Object *QuoteFunction::Eval(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
     return args[1];
 }
 
-Object *PNumberFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    return GetBooleanFunction(Is<Number>(args[1]->Eval(context)), context);
+Object *PNumberFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    return GetBooleanFunction(IsNumber(args[0]), context);
 }
 
-Object *EqualFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    bool res = true;
-    bool was = false;
-    FoldNumber(
-        args.begin() + 1, args.end(), 0,
-        [&res, &was](int64_t a, int64_t b) {
-            if (!was) {
-                was = true;
-            } else if (a != b) {
-                res = false;
-            }
-            return b;
-        },
-        context);
-    return GetBooleanFunction(res, context);
+Object *EqualFunction::Apply(const Arguments &args, Context &context) {
+    return GetBooleanFunction(IsMonotone(args, [](int cmp) { return cmp == 0; }), context);
 }
 
-Object *MonIncFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    bool res = true;
-    bool was = false;
-    FoldNumber(
-        args.begin() + 1, args.end(), 0,
-        [&res, &was](int64_t a, int64_t b) {
-            if (!was) {
-                was = true;
-            } else if (a >= b) {
-                res = false;
-            }
-            return b;
-        },
-        context);
-    return GetBooleanFunction(res, context);
+Object *MonIncFunction::Apply(const Arguments &args, Context &context) {
+    return GetBooleanFunction(IsMonotone(args, [](int cmp) { return cmp < 0; }), context);
 }
 
-Object *MonDecFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    bool res = true;
-    bool was = false;
-    FoldNumber(
-        args.begin() + 1, args.end(), 0,
-        [&res, &was](int64_t a, int64_t b) {
-            if (!was) {
-                was = true;
-            } else if (a <= b) {
-                res = false;
-            }
-            return b;
-        },
-        context);
-    return GetBooleanFunction(res, context);
+Object *MonDecFunction::Apply(const Arguments &args, Context &context) {
+    return GetBooleanFunction(IsMonotone(args, [](int cmp) { return cmp > 0; }), context);
 }
 
-Object *MonNonIncFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    bool res = true;
-    bool was = false;
-    FoldNumber(
-        args.begin() + 1, args.end(), 0,
-        [&res, &was](int64_t a, int64_t b) {
-            if (!was) {
-                was = true;
-            } else if (a < b) {
-                res = false;
-            }
-            return b;
-        },
-        context);
-    return GetBooleanFunction(res, context);
+Object *MonNonIncFunction::Apply(const Arguments &args, Context &context) {
+    return GetBooleanFunction(IsMonotone(args, [](int cmp) { return cmp >= 0; }), context);
 }
 
-Object *MonNonDecFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    bool res = true;
-    bool was = false;
-    FoldNumber(
-        args.begin() + 1, args.end(), 0,
-        [&res, &was](int64_t a, int64_t b) {
-            if (!was) {
-                was = true;
-            } else if (a > b) {
-                res = false;
+Object *MonNonDecFunction::Apply(const Arguments &args, Context &context) {
+    return GetBooleanFunction(IsMonotone(args, [](int cmp) { return cmp <= 0; }), context);
+}
+
+Object *PlusFunction::Apply(const Arguments &args, Context &context) {
+    return FoldNumber(
+        args, 0, MakeSharedNumber(0, context),
+        [](int64_t a, int64_t b, int64_t *res) { return __builtin_add_overflow(a, b, res); },
+        [](const BigInteger &a, const BigInteger &b) { return a + b; },
+        [](double a, double b) { return a + b; }, context);
+}
+
+Object *MinusFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() >= 1);
+    return FoldNumber(
+        args, 1, args[0],
+        [](int64_t a, int64_t b, int64_t *res) { return __builtin_sub_overflow(a, b, res); },
+        [](const BigInteger &a, const BigInteger &b) { return a - b; },
+        [](double a, double b) { return a - b; }, context);
+}
+
+Object *MultiplyFunction::Apply(const Arguments &args, Context &context) {
+    return FoldNumber(
+        args, 0, MakeSharedNumber(1, context),
+        [](int64_t a, int64_t b, int64_t *res) { return __builtin_mul_overflow(a, b, res); },
+        [](const BigInteger &a, const BigInteger &b) { return a * b; },
+        [](double a, double b) { return a * b; }, context);
+}
+
+Object *DivisionFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() >= 1);
+    return FoldNumber(
+        args, 1, args[0],
+        [](int64_t a, int64_t b, int64_t *res) {
+            RuntimeAssert(b != 0);
+            // The only quotient that does not fit.
+            if (a == INT64_MIN && b == -1) {
+                return true;
             }
-            return b;
+            *res = a / b;
+            return false;
         },
-        context);
-    return GetBooleanFunction(res, context);
-}
-
-Object *PlusFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    int64_t res = FoldNumber(
-        args.begin() + 1, args.end(), 0, [](int64_t a, int64_t b) { return a + b; }, context);
-    return MakeSharedNumber(res, context);
-}
-
-Object *MinusFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() >= 2);
-    auto init = args[1]->Eval(context);
-    RuntimeAssert(Is<Number>(init));
-    int64_t res = FoldNumber(
-        args.begin() + 2, args.end(), As<Number>(init)->GetValue(),
-        [](int64_t a, int64_t b) { return a - b; }, context);
-    return MakeSharedNumber(res, context);
-}
-
-Object *MultiplyFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    int64_t res = FoldNumber(
-        args.begin() + 1, args.end(), 1, [](int64_t a, int64_t b) { return a * b; }, context);
-    return MakeSharedNumber(res, context);
-}
-
-Object *DivisionFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() >= 2);
-    auto init = args[1]->Eval(context);
-    RuntimeAssert(Is<Number>(init));
-    int64_t res = FoldNumber(
-        args.begin() + 2, args.end(), As<Number>(init)->GetValue(),
-        [](int64_t a, int64_t b) { return a / b; }, context);
-    return MakeSharedNumber(res, context);
-}
-
-Object *MaxFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() >= 2);
-    auto init = args[1]->Eval(context);
-    RuntimeAssert(Is<Number>(init));
-    int64_t res = FoldNumber(
-        args.begin() + 2, args.end(), As<Number>(init)->GetValue(),
-        [](int64_t a, int64_t b) { return std::max(a, b); }, context);
-    return MakeSharedNumber(res, context);
-}
-
-Object *MinFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() >= 2);
-    auto init = args[1]->Eval(context);
-    RuntimeAssert(Is<Number>(init));
-    int64_t res = FoldNumber(
-        args.begin() + 2, args.end(), As<Number>(init)->GetValue(),
-        [](int64_t a, int64_t b) { return std::min(a, b); }, context);
-    return MakeSharedNumber(res, context);
-}
-
-Object *AbsFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    auto init = args[1]->Eval(context);
-    RuntimeAssert(Is<Number>(init));
-    return MakeSharedNumber(std::abs(As<Number>(init)->GetValue()), context);
-}
-
-Object *PPairFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    auto obj = args[1]->Eval(context);
+        [](const BigInteger &a, const BigInteger &b) { return a / b; },
+        [](double a, double b) { return a / b; }, context);
+}
+
+Object *MaxFunction::Apply(const Arguments &args, Context &context) {
+    return SelectNumber(args, [](int cmp) { return cmp > 0; }, context);
+}
+
+Object *MinFunction::Apply(const Arguments &args, Context &context) {
+    return SelectNumber(args, [](int cmp) { return cmp < 0; }, context);
+}
+
+Object *AbsFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && IsNumber(args[0]));
+    if (Is<Flonum>(args[0])) {
+        return MakeFlonum(std::fabs(As<Flonum>(args[0])->GetValue()), context);
+    }
+    if (Is<Number>(args[0]) && As<Number>(args[0])->GetValue() != INT64_MIN) {
+        return MakeSharedNumber(std::abs(As<Number>(args[0])->GetValue()), context);
+    }
+    BigInteger value = ToBigInteger(args[0]);
+    return MakeInteger(value.IsNegative() ? -value : std::move(value), context);
+}
+
+Object *PPairFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    auto obj = args[0];
     if (!Is<Cell>(obj)) {
         return GetBooleanFunction(false, context);
     }
-    auto check_list = ParseToList(As<Cell>(obj));
-    return GetBooleanFunction(check_list.objects.size() == 2, context);
+    size_t size = 0;
+    for (ListIterator it(As<Cell>(obj)); !it.AtEnd() && size < 3; ++it) {
+        ++size;
+    }
+    return GetBooleanFunction(size == 2, context);
 }
 
-Object *PNullFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    auto obj = args[1]->Eval(context);
-    return GetBooleanFunction(obj == nullptr, context);
+Object *PNullFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    return GetBooleanFunction(args[0] == nullptr, context);
 }
 
-Object *PListFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    auto obj = args[1]->Eval(context);
+Object *PListFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    auto obj = args[0];
     if (obj == nullptr) {
         return GetBooleanFunction(true, context);
     }
     if (!Is<Cell>(obj)) {
         return GetBooleanFunction(false, context);
     }
-    auto check_list = ParseToList(As<Cell>(obj));
-    return GetBooleanFunction(!check_list.is_wrong, context);
+    ListIterator it(As<Cell>(obj));
+    while (!it.AtEnd() && !it.IsTail()) {
+        ++it;
+    }
+    return GetBooleanFunction(it.AtEnd(), context);
 }
 
-Object *ConsFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 3);
+Object *ConsFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
     Cell *result = MakeObject<Cell>(context);
-    result->SetFirst(args[1]->Eval(context));
-    result->SetSecond(args[2]->Eval(context));
+    result->SetFirst(args[0]);
+    result->SetSecond(args[1]);
     return result;
 }
 
-Object *CarFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    auto obj = args[1]->Eval(context);
-    RuntimeAssert(Is<Cell>(obj));
-    return As<Cell>(obj)->GetFirst();
+Object *CarFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<Cell>(args[0]));
+    return As<Cell>(args[0])->GetFirst();
 }
 
-Object *CdrFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    auto obj = args[1]->Eval(context);
-    RuntimeAssert(Is<Cell>(obj));
-    return As<Cell>(obj)->GetSecond();
+Object *CdrFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<Cell>(args[0]));
+    return As<Cell>(args[0])->GetSecond();
 }
 
-Object *ListFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    List result;
-    result.objects.reserve(args.size() - 1);
-    for (size_t i = 1; i < args.size(); ++i) {
-        result.objects.push_back(args[i]->Eval(context));
+Object *ListFunction::Apply(const Arguments &args, Context &context) {
+    Object *result = nullptr;
+    for (size_t i = args.Size(); i-- > 0;) {
+        Cell *cell = MakeObject<Cell>(context);
+        cell->SetFirst(args[i]);
+        cell->SetSecond(result);
+        result = cell;
     }
-    return ParseToCell(result, context);
+    return result;
 }
 
-Object *ListRefFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 3);
-    auto lst = args[1]->Eval(context);
-    auto pos = args[2]->Eval(context);
-    RuntimeAssert(Is<Cell>(lst) && Is<Number>(pos));
-    List argList = ParseToList(As<Cell>(lst));
-    size_t intPos = As<Number>(pos)->GetValue();
-    RuntimeAssert(intPos < argList.objects.size() - argList.is_wrong);
-    return argList.objects[intPos];
+Object *ListRefFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
+    auto rest = DropElements(args[0], args[1]);
+    RuntimeAssert(Is<Cell>(rest));
+    return As<Cell>(rest)->GetFirst();
 }
 
-Object *ListTailFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 3);
-    auto lst = args[1]->Eval(context);
-    auto pos = args[2]->Eval(context);
-    RuntimeAssert(Is<Cell>(lst) && Is<Number>(pos));
-    List argList = ParseToList(As<Cell>(lst));
-    size_t intPos = As<Number>(pos)->GetValue();
-    RuntimeAssert(intPos <= argList.objects.size() - argList.is_wrong);
-    List result;
-    result.objects.reserve(argList.objects.size() - intPos);
-    for (size_t i = intPos; i < argList.objects.size(); ++i) {
-        result.objects.push_back(argList.objects[i]);
+Object *ListTailFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
+    return DropElements(args[0], args[1]);
+}
+
+Object *LengthFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    int64_t length = 0;
+    for (Object *rest = args[0]; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+        RuntimeAssert(Is<Cell>(rest));
+        ++length;
+    }
+    return MakeSharedNumber(length, context);
+}
+
+Object *AppendFunction::Apply(const Arguments &args, Context &context) {
+    if (args.Size() == 0) {
+        return nullptr;
+    }
+    // Every list but the last is copied; the last one becomes the shared
+    // tail of the result and may be any object.
+    Object *head = nullptr;
+    Cell *last = nullptr;
+    for (size_t i = 0; i + 1 < args.Size(); ++i) {
+        for (Object *rest = args[i]; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+            RuntimeAssert(Is<Cell>(rest));
+            Cell *cell = MakeObject<Cell>(context);
+            cell->SetFirst(As<Cell>(rest)->GetFirst());
+            if (last == nullptr) {
+                head = cell;
+            } else {
+                last->SetSecond(cell);
+            }
+            last = cell;
+        }
+    }
+    if (last == nullptr) {
+        return args[args.Size() - 1];
+    }
+    last->SetSecond(args[args.Size() - 1]);
+    return head;
+}
+
+Object *ReverseFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    Object *result = nullptr;
+    for (Object *rest = args[0]; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+        RuntimeAssert(Is<Cell>(rest));
+        Cell *cell = MakeObject<Cell>(context);
+        cell->SetFirst(As<Cell>(rest)->GetFirst());
+        cell->SetSecond(result);
+        result = cell;
+    }
+    return result;
+}
+
+Object *LastPairFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<Cell>(args[0]));
+    Cell *cell = As<Cell>(args[0]);
+    while (Is<Cell>(cell->GetSecond())) {
+        cell = As<Cell>(cell->GetSecond());
+    }
+    return cell;
+}
+
+Object *MemberFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
+    for (Object *rest = args[1]; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+        RuntimeAssert(Is<Cell>(rest));
+        if (IsEqual(args[0], As<Cell>(rest)->GetFirst())) {
+            return rest;
+        }
+    }
+    return GetBooleanFunction(false, context);
+}
+
+Object *AssocFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
+    for (Object *rest = args[1]; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+        RuntimeAssert(Is<Cell>(rest) && Is<Cell>(As<Cell>(rest)->GetFirst()));
+        auto entry = As<Cell>(As<Cell>(rest)->GetFirst());
+        if (IsEqual(args[0], entry->GetFirst())) {
+            return entry;
+        }
+    }
+    return GetBooleanFunction(false, context);
+}
+
+Object *MapFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() >= 2);
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    std::vector<Object *> rests = GetLists(args, 1);
+    // The result is built front to back and rooted through its head.
+    size_t head = heap->GetStack().size();
+    heap->PushRoot(nullptr);
+    Cell *last = nullptr;
+    while (AllPairs(rests)) {
+        PushCars(&rests, heap);
+        Object *value = ApplyFromStack(args[0], rests.size(), context);
+        Cell *cell = MakeObject<Cell>(context);
+        cell->SetFirst(value);
+        if (last == nullptr) {
+            heap->GetStack()[head] = cell;
+        } else {
+            last->SetSecond(cell);
+        }
+        last = cell;
+    }
+    return heap->GetStack()[head];
+}
+
+Object *ForEachFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() >= 2);
+    Heap *heap = context.GetHeap();
+    std::vector<Object *> rests = GetLists(args, 1);
+    while (AllPairs(rests)) {
+        PushCars(&rests, heap);
+        ApplyFromStack(args[0], rests.size(), context);
+    }
+    return nullptr;
+}
+
+Object *FilterFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    size_t head = heap->GetStack().size();
+    heap->PushRoot(nullptr);
+    Cell *last = nullptr;
+    for (Object *rest = args[1]; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+        RuntimeAssert(Is<Cell>(rest));
+        Object *element = As<Cell>(rest)->GetFirst();
+        heap->PushRoot(element);
+        if (!ToBool(ApplyFromStack(args[0], 1, context))) {
+            continue;
+        }
+        Cell *cell = MakeObject<Cell>(context);
+        cell->SetFirst(element);
+        if (last == nullptr) {
+            heap->GetStack()[head] = cell;
+        } else {
+            last->SetSecond(cell);
+        }
+        last = cell;
     }
-    result.is_wrong = argList.is_wrong;
-    return ParseToCell(result, context);
+    return heap->GetStack()[head];
 }
 
-Object *PBooleanFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    auto obj = args[1]->Eval(context);
-    return GetBooleanFunction(Is<True>(obj) || Is<False>(obj), context);
+Object *FoldLeftFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() >= 3);
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    std::vector<Object *> rests = GetLists(args, 2);
+    Object *acc = args[1];
+    while (AllPairs(rests)) {
+        heap->PushRoot(acc);
+        PushCars(&rests, heap);
+        acc = ApplyFromStack(args[0], rests.size() + 1, context);
+    }
+    return acc;
+}
+
+Object *ApplyFunction::Apply(const Arguments &args, Context &context) {
+    TailCall tail;
+    Object *res = ApplyTail(args, context, &tail);
+    return FinishTailCall(res, &tail, context);
+}
+
+Object *ApplyFunction::ApplyTail(const Arguments &args, Context &context, TailCall *tail) {
+    RuntimeAssert(args.Size() >= 2 && Is<Function>(args[0]));
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    std::vector<Object *> &stack = heap->GetStack();
+    size_t begin = stack.size();
+    for (size_t i = 1; i + 1 < args.Size(); ++i) {
+        heap->PushRoot(args[i]);
+    }
+    for (Object *rest = args[args.Size() - 1]; rest != nullptr; rest = As<Cell>(rest)->GetSecond()) {
+        RuntimeAssert(Is<Cell>(rest));
+        heap->PushRoot(As<Cell>(rest)->GetFirst());
+    }
+    return As<Function>(args[0])->ApplyTail(Arguments(&stack, begin, stack.size() - begin), context,
+                                            tail);
 }
 
-Object *NotFuntion::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    RuntimeAssert(args.size() == 2);
-    return GetBooleanFunction(!ToBool(args[1]->Eval(context)), context);
+Object *PMapFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2 && Is<Function>(args[0]));
+    Object *func = args[0];
+    std::vector<Object *> elements = ListElements(args[1]);
+    auto chunks = SplitIntoChunks(elements.size(), context.GetHeap());
+    ParallelFor(chunks.size(), [&](size_t index) {
+        ParallelChunk &chunk = *chunks[index];
+        for (size_t i = chunk.begin; i < chunk.end; ++i) {
+            chunk.heap.PushRoot(elements[i]);
+            chunk.results.push_back(ApplyFromStack(func, 1, *chunk.context));
+        }
+    });
+    Heap *heap = context.GetHeap();
+    std::unordered_map<Object *, Object *> copies;
+    Object *head = nullptr;
+    Cell *last = nullptr;
+    for (auto &chunk : chunks) {
+        for (auto result : chunk->results) {
+            Cell *cell = heap->Make<Cell>();
+            cell->SetFirst(CopyToHeap(result, chunks, heap, &copies));
+            if (last == nullptr) {
+                head = cell;
+            } else {
+                last->SetSecond(cell);
+            }
+            last = cell;
+        }
+    }
+    return head;
 }
 
-Object *AndFunction::Eval(const List &list, Context &context) {
-    for (size_t i = 1; i < list.objects.size(); ++i) {
-        auto obj = list.objects[i]->Eval(context);
-        if (!ToBool(obj) || i + 1 == list.objects.size()) {
+Object *PReduceFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 3 && Is<Function>(args[0]));
+    Object *func = args[0];
+    std::vector<Object *> elements = ListElements(args[2]);
+    auto chunks = SplitIntoChunks(elements.size(), context.GetHeap());
+    ParallelFor(chunks.size(), [&](size_t index) {
+        ParallelChunk &chunk = *chunks[index];
+        if (chunk.begin == chunk.end) {
+            return;
+        }
+        Object *acc = elements[chunk.begin];
+        for (size_t i = chunk.begin + 1; i < chunk.end; ++i) {
+            chunk.heap.PushRoot(acc);
+            chunk.heap.PushRoot(elements[i]);
+            acc = ApplyFromStack(func, 2, *chunk.context);
+        }
+        chunk.results.push_back(acc);
+    });
+    // The partial results are combined on this thread, left to right. They
+    // are all copied and rooted first, since op may drop the last reference
+    // the interpreter held to an object a later result shares.
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    std::unordered_map<Object *, Object *> copies;
+    size_t begin = heap->GetStack().size();
+    for (auto &chunk : chunks) {
+        for (auto result : chunk->results) {
+            heap->PushRoot(CopyToHeap(result, chunks, heap, &copies));
+        }
+    }
+    size_t end = heap->GetStack().size();
+    Object *acc = args[1];
+    for (size_t i = begin; i < end; ++i) {
+        heap->PushRoot(acc);
+        heap->PushRoot(heap->GetStack()[i]);
+        acc = ApplyFromStack(func, 2, context);
+    }
+    return acc;
+}
+
+Object *PVectorFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    return GetBooleanFunction(Is<Vector>(args[0]), context);
+}
+
+Object *MakeVectorFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert((args.Size() == 1 || args.Size() == 2) && Is<Number>(args[0]) &&
+                  As<Number>(args[0])->GetValue() >= 0);
+    // Without a fill value the elements are 0.
+    Object *fill = args.Size() == 2 ? args[1] : MakeSharedNumber(0, context);
+    return context.GetHeap()->Make<Vector>(
+        std::vector<Object *>(As<Number>(args[0])->GetValue(), fill));
+}
+
+Object *VectorFunction::Apply(const Arguments &args, Context &context) {
+    std::vector<Object *> elements(args.Size());
+    for (size_t i = 0; i < args.Size(); ++i) {
+        elements[i] = args[i];
+    }
+    return context.GetHeap()->Make<Vector>(std::move(elements));
+}
+
+Object *VectorLengthFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<Vector>(args[0]));
+    return MakeSharedNumber(As<Vector>(args[0])->Size(), context);
+}
+
+Object *VectorRefFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2 && Is<Vector>(args[0]));
+    return As<Vector>(args[0])->Get(VectorIndex(As<Vector>(args[0]), args[1]));
+}
+
+Object *VectorSetFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 3 && Is<Vector>(args[0]));
+    RuntimeAssert(!context.GetHeap()->IsWorkerMode());
+    As<Vector>(args[0])->Set(VectorIndex(As<Vector>(args[0]), args[1]), args[2]);
+    return nullptr;
+}
+
+Object *PHashTableFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    return GetBooleanFunction(Is<HashTable>(args[0]), context);
+}
+
+Object *MakeHashTableFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 0);
+    return context.GetHeap()->Make<HashTable>(context.GetHeap());
+}
+
+Object *HashTableRefFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert((args.Size() == 2 || args.Size() == 3) && Is<HashTable>(args[0]));
+    if (auto value = As<HashTable>(args[0])->Find(args[1])) {
+        return *value;
+    }
+    // A missing key is an error unless a thunk supplies the result.
+    RuntimeAssert(args.Size() == 3);
+    return ApplyFromStack(args[2], 0, context);
+}
+
+Object *HashTableRefDefaultFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 3 && Is<HashTable>(args[0]));
+    auto value = As<HashTable>(args[0])->Find(args[1]);
+    return value ? *value : args[2];
+}
+
+Object *HashTableSetFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 3 && Is<HashTable>(args[0]));
+    RuntimeAssert(!context.GetHeap()->IsWorkerMode());
+    As<HashTable>(args[0])->Set(args[1], args[2]);
+    return nullptr;
+}
+
+Object *HashTableDeleteFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2 && Is<HashTable>(args[0]));
+    RuntimeAssert(!context.GetHeap()->IsWorkerMode());
+    As<HashTable>(args[0])->Erase(args[1]);
+    return nullptr;
+}
+
+Object *HashTableContainsFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2 && Is<HashTable>(args[0]));
+    return GetBooleanFunction(As<HashTable>(args[0])->Find(args[1]) != nullptr, context);
+}
+
+Object *HashTableCountFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<HashTable>(args[0]));
+    return MakeSharedNumber(As<HashTable>(args[0])->Size(), context);
+}
+
+Object *HashTableKeysFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<HashTable>(args[0]));
+    Object *result = nullptr;
+    As<HashTable>(args[0])->ForEach([&](Object *key, Object *) {
+        Cell *cell = MakeObject<Cell>(context);
+        cell->SetFirst(key);
+        cell->SetSecond(result);
+        result = cell;
+    });
+    return result;
+}
+
+Object *HashTableValuesFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<HashTable>(args[0]));
+    Object *result = nullptr;
+    As<HashTable>(args[0])->ForEach([&](Object *, Object *value) {
+        Cell *cell = MakeObject<Cell>(context);
+        cell->SetFirst(value);
+        cell->SetSecond(result);
+        result = cell;
+    });
+    return result;
+}
+
+Object *HashTableToAlistFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1 && Is<HashTable>(args[0]));
+    Object *result = nullptr;
+    As<HashTable>(args[0])->ForEach([&](Object *key, Object *value) {
+        Cell *entry = MakeObject<Cell>(context);
+        entry->SetFirst(key);
+        entry->SetSecond(value);
+        Cell *cell = MakeObject<Cell>(context);
+        cell->SetFirst(entry);
+        cell->SetSecond(result);
+        result = cell;
+    });
+    return result;
+}
+
+Object *HashTableWalkFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2 && Is<HashTable>(args[0]));
+    Heap *heap = context.GetHeap();
+    Heap::RootGuard guard(heap);
+    // proc may modify the table, so it sees the bindings as of the call,
+    // kept rooted on the stack below its arguments.
+    size_t begin = heap->GetStack().size();
+    As<HashTable>(args[0])->ForEach([heap](Object *key, Object *value) {
+        heap->PushRoot(key);
+        heap->PushRoot(value);
+    });
+    size_t end = heap->GetStack().size();
+    for (size_t i = begin; i < end; i += 2) {
+        heap->PushRoot(heap->GetStack()[i]);
+        heap->PushRoot(heap->GetStack()[i + 1]);
+        ApplyFromStack(args[1], 2, context);
+    }
+    return nullptr;
+}
+
+Object *PBooleanFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    return GetBooleanFunction(Is<True>(args[0]) || Is<False>(args[0]), context);
+}
+
+Object *NotFuntion::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    return GetBooleanFunction(!ToBool(args[0]), context);
+}
+
+Object *AndFunction::EvalTail(const Arguments &args, Context &context, TailCall *tail) {
+    for (size_t i = 1; i < args.Size(); ++i) {
+        if (i + 1 == args.Size()) {
+            return EvalInTail(args[i], context, tail);
+        }
+        auto obj = args[i]->Eval(context);
+        if (!ToBool(obj)) {
             return obj;
         }
     }
     return GetBooleanFunction(true, context);
 }
 
-Object *OrFunction::Eval(const List &list, Context &context) {
-    for (size_t i = 1; i < list.objects.size(); ++i) {
-        auto obj = list.objects[i]->Eval(context);
-        if (ToBool(obj) || i + 1 == list.objects.size()) {
+Object *OrFunction::EvalTail(const Arguments &args, Context &context, TailCall *tail) {
+    for (size_t i = 1; i < args.Size(); ++i) {
+        if (i + 1 == args.Size()) {
+            return EvalInTail(args[i], context, tail);
+        }
+        auto obj = args[i]->Eval(context);
+        if (ToBool(obj)) {
             return obj;
         }
     }
     return GetBooleanFunction(false, context);
 }
 
-Object *IfFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(1 < args.size() && args.size() < 5);
+Object *IfFunction::EvalTail(const Arguments &args, Context &context, TailCall *tail) {
+    SyntaxAssert(2 < args.Size() && args.Size() < 5);
     if (ToBool(args[1]->Eval(context))) {
-        return args[2]->Eval(context);
-    } else if (args.size() > 3) {
-        return args[3]->Eval(context);
+        return EvalInTail(args[2], context, tail);
+    } else if (args.Size() > 3) {
+        return EvalInTail(args[3], context, tail);
     }
     return nullptr;
 }
 
-Object *LambdaBuilderFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(args.size() >= 3);
+Object *LambdaBuilderFunction::Eval(const Arguments &args, Context &context) {
+    SyntaxAssert(args.Size() >= 3);
     LambdaFunction *lambda = MakeObject<LambdaFunction>(context);
-    auto lambda_args = args[1] == nullptr ? List() : ParseToList(As<Cell>(args[1]));
-    lambda->context_ = std::make_shared<Context>();
-    lambda->context_->SetUp(context.shared_from_this());
-    lambda->context_->SetData(context.GetData());
-
-    //    lambda->context_.SetUp(context);
-    lambda->args_.reserve(lambda_args.objects.size());
-    for (auto ptr : lambda_args.objects) {
-        RuntimeAssert(Is<Symbol>(ptr));
-        lambda->args_.push_back(As<Symbol>(ptr)->GetName());
-    }
-    lambda->functions_.reserve(args.size() - 2);
-    for (size_t i = 2; i < args.size(); ++i) {
+    size_t arity = 0;
+    if (Is<Cell>(args[1])) {
+        for (ListIterator it(As<Cell>(args[1])); !it.AtEnd(); ++it, ++arity) {
+            RuntimeAssert(Is<Symbol>(*it));
+        }
+    }
+    lambda->arity_ = arity;
+    lambda->frame_size_ = std::max(frame_size_, lambda->arity_);
+    lambda->context_ = context.shared_from_this();
+    lambda->functions_.reserve(args.Size() - 2);
+    for (size_t i = 2; i < args.Size(); ++i) {
         lambda->functions_.push_back(args[i]);
     }
     return lambda;
 }
 
-Object *LambdaFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(args.size() == args_.size() + 1);
-    for (size_t i = 1; i < args.size(); ++i) {
-        context_->AddVariable(args_[i - 1], args[i]->Eval(*context_));
+std::shared_ptr<Context> LambdaFunction::BindArguments(const Arguments &args, Heap *heap) {
+    SyntaxAssert(args.Size() == arity_);
+    auto frame = heap->AcquireFrame(context_, frame_size_);
+    for (size_t i = 0; i < args.Size(); ++i) {
+        frame->SetSlot(0, i, args[i]);
+    }
+    return frame;
+}
+
+LambdaFunction *LambdaFunction::Clone(Context &context) {
+    LambdaFunction *lambda = context.GetHeap()->Make<LambdaFunction>(*this);
+    lambda->context_ = context.shared_from_this();
+    return lambda;
+}
+
+Object *LambdaFunction::Apply(const Arguments &args, Context &context) {
+    TailCall tail;
+    Object *res = ApplyTail(args, context, &tail);
+    return FinishTailCall(res, &tail, context);
+}
+
+Object *LambdaFunction::ApplyTail(const Arguments &args, Context &context, TailCall *tail) {
+    Heap::FrameGuard frame(context.GetHeap(), BindArguments(args, context.GetHeap()));
+    for (size_t i = 0; i + 1 < functions_.size(); ++i) {
+        RuntimeAssert(functions_[i] != nullptr);
+        functions_[i]->Eval(*frame);
     }
-    Object *res;
-    for (auto &f : functions_) {
-        res = f->Eval(*context_);
+    Object *res = EvalInTail(functions_.back(), *frame, tail);
+    if (tail->form != nullptr) {
+        tail->frame = frame.Release();
     }
     return res;
 }
 
-Object *DefineFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(args.size() == 3);
-    if (Is<Cell>(args[1])) {
-        auto func = ParseToList(As<Cell>(args[1]));
-        RuntimeAssert(Is<Symbol>(func.objects[0]));
-        List func_args;
-        func_args.objects.reserve(func.objects.size() - 1);
-        for (size_t i = 1; i < func.objects.size(); ++i) {
-            func_args.objects.push_back(func.objects[i]);
-        }
-        auto func_args_cell = ParseToCell(func_args, context);
-        List to_lambda;
-        to_lambda.objects = {nullptr, func_args_cell, args[2]};
-        auto lambda = LambdaBuilderFunction().Eval(to_lambda, context);
-        context.AddVariable(As<Symbol>(func.objects[0])->GetName(), lambda);
-        As<LambdaFunction>(lambda)->context_ = std::make_shared<Context>(context);
-        return nullptr;
+void LambdaFunction::Trace(Heap *heap) {
+    heap->MarkContext(context_.get());
+    for (auto f : functions_) {
+        heap->MarkObject(f);
     }
-    RuntimeAssert(Is<Symbol>(args[1]) && args[2] != nullptr);
+    heap->MarkObject(code_);
+}
+
+Object *DefineFunction::Eval(const Arguments &args, Context &context) {
+    // (define (f args...) body...) has already been rewritten by the analyzer.
+    SyntaxAssert(args.Size() == 3);
+    RuntimeAssert(IsVariable(args[1]) && args[2] != nullptr);
     auto to_add = args[2]->Eval(context);
-    context.AddVariable(As<Symbol>(args[1])->GetName(), to_add);
+    AssignVariable(args[1], to_add, context);
     return nullptr;
 }
 
-Object *SetFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(args.size() == 3 && Is<Symbol>(args[1]));
-    NameAssert(context.HasVariable(As<Symbol>(args[1])->GetName()));
-    context.AddVariable(As<Symbol>(args[1])->GetName(), args[2]->Eval(context));
+Object *SetFunction::Eval(const Arguments &args, Context &context) {
+    SyntaxAssert(args.Size() == 3 && IsVariable(args[1]));
+    NameAssert(IsBoundVariable(args[1], context));
+    AssignVariable(args[1], args[2]->Eval(context), context);
     return nullptr;
 }
 
-Object *SetCdrFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(args.size() == 3 && Is<Symbol>(args[1]) && args[2] != nullptr);
+Object *SetCdrFunction::Eval(const Arguments &args, Context &context) {
+    SyntaxAssert(args.Size() == 3 && IsVariable(args[1]) && args[2] != nullptr);
+    auto value = args[2]->Eval(context);
     Cell *res = MakeObject<Cell>(context);
-    res->SetSecond(args[2]->Eval(context));
-    context.AddVariable(As<Symbol>(args[1])->GetName(), res);
+    res->SetSecond(value);
+    AssignVariable(args[1], res, context);
     return nullptr;
 }
 
-Object *SetCarFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(args.size() == 3 && Is<Symbol>(args[1]) && args[2] != nullptr);
+Object *SetCarFunction::Eval(const Arguments &args, Context &context) {
+    SyntaxAssert(args.Size() == 3 && IsVariable(args[1]) && args[2] != nullptr);
+    auto value = args[2]->Eval(context);
     Cell *res = MakeObject<Cell>(context);
-    res->SetFirst(args[2]->Eval(context));
-    context.AddVariable(As<Symbol>(args[1])->GetName(), res);
+    res->SetFirst(value);
+    AssignVariable(args[1], res, context);
     return nullptr;
 }
 
-Object *PSymbolFunction::Eval(const List &list, Context &context) {
-    const std::vector<Object *> &args = list.objects;
-    SyntaxAssert(args.size() == 2);
-    return GetBooleanFunction(Is<Symbol>(args[1]->Eval(context)), context);
+Object *PSymbolFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 1);
+    return GetBooleanFunction(Is<Symbol>(args[0]), context);
+}
+
+Object *EqFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
+    return GetBooleanFunction(IsEqv(args[0], args[1]), context);
+}
+
+Object *StructuralEqualFunction::Apply(const Arguments &args, Context &context) {
+    RuntimeAssert(args.Size() == 2);
+    return GetBooleanFunction(IsEqual(args[0], args[1]), context);
 }
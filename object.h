@@ -4,54 +4,110 @@
 #include "error.h"
 #include "function_registry.h"
 #include "context.h"
+#include "heap.h"
+#include "symbol_table.h"
+#include "bigint.h"
 
 #include <memory>
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
+#include <type_traits>
 #include <vector>
 
-template <class T>
-bool Is(Object* obj) {
-    return dynamic_cast<T*>(obj) != nullptr;
-}
+// Tag stored in every object so that type checks are a load and a compare
+// instead of a dynamic_cast. Classes that are tested for declare their tag
+// as kType.
+enum class ObjectType : uint8_t {
+    kNumber,
+    kBigNum,
+    kFlonum,
+    kSymbol,
+    kLocalVariable,
+    kCell,
+    kVector,
+    kHashTable,
+    kCompiledCode,
+    // Everything from here on is a Function.
+    kFunction,
+    kTrue,
+    kFalse,
+    kLambdaBuilder,
+    kLambda,
+};
 
-template <class T>
-T* As(Object* obj) {
-    RuntimeAssert(obj != nullptr);
-    return dynamic_cast<T*>(obj);
-}
+Function* GetBooleanFunction(bool boolean, Context& context);
 
-template <class Iterator, class BinaryOp>
-int64_t FoldNumber(Iterator first, Iterator last, int64_t init, BinaryOp func, Context& context) {
-    while (first != last) {
-        RuntimeAssert(*first != nullptr);
-        auto ptr = (*first)->Eval(context);
-        RuntimeAssert(Is<Number>(ptr));
-        int64_t number = As<Number>(ptr)->GetValue();
-        init = func(init, number);
-        ++first;
-    }
-    return init;
-}
+bool ToBool(Object* obj);
 
-Function* GetBooleanFunction(bool boolean, Context& context);
+// eqv?: identity, except that numbers are compared by value.
+bool IsEqv(Object* lhs, Object* rhs);
 
-bool ToBool(const Object* func);
+// equal?: eqv? extended structurally over lists and vectors.
+bool IsEqual(Object* lhs, Object* rhs);
 
 List ParseToList(Cell* obj);
 
-Cell* ParseToCell(List& list);
+// Pushes the elements of a list onto the evaluator stack and returns how
+// many there are; call forms are evaluated from there without a List.
+size_t PushList(Cell* list, Heap* heap);
 
-class Object : public std::enable_shared_from_this<Object> {
+class Object {
 public:
+    explicit Object(ObjectType type) : type_(type) {
+    }
+    // Copies are fresh allocations and start out unmarked.
+    Object(const Object& other) : type_(other.type_) {
+    }
+    Object& operator=(const Object&) = delete;
+
+    ObjectType GetType() const {
+        return type_;
+    }
+
     virtual Object* Eval(Context& context) = 0;
     virtual void Print(std::ostream* out) = 0;
+    // Reports every object and context directly reachable from this one.
+    virtual void Trace(Heap* heap) {
+    }
+    // Memory owned outside the object itself, such as element storage,
+    // which the heap counts toward the collection threshold.
+    virtual size_t ExtraBytes() const {
+        return 0;
+    }
     virtual ~Object() = default;
+
+private:
+    ObjectType type_;
+    bool marked_ = false;
+
+private:
+    friend class Heap;
 };
 
+template <class T>
+bool Is(Object* obj) {
+    if (obj == nullptr) {
+        return false;
+    }
+    if constexpr (std::is_same_v<T, Function>) {
+        return obj->GetType() >= ObjectType::kFunction;
+    } else {
+        return obj->GetType() == T::kType;
+    }
+}
+
+template <class T>
+T* As(Object* obj) {
+    RuntimeAssert(obj != nullptr);
+    return Is<T>(obj) ? static_cast<T*>(obj) : nullptr;
+}
+
 class Number : public Object {
 public:
-    Number(int64_t number) : number_(number) {
+    static constexpr ObjectType kType = ObjectType::kNumber;
+
+    Number(int64_t number) : Object(kType), number_(number) {
     }
     void Print(std::ostream* out) override {
         (*out) << number_;
@@ -67,21 +123,111 @@ private:
     int64_t number_;
 };
 
+// Integer outside the int64_t range. Arithmetic promotes to it on
+// overflow and demotes results that fit back to Number, so a BigNum never
+// equals a Number.
+class BigNum : public Object {
+public:
+    static constexpr ObjectType kType = ObjectType::kBigNum;
+
+    explicit BigNum(BigInteger value) : Object(kType), value_(std::move(value)) {
+    }
+    void Print(std::ostream* out) override {
+        (*out) << value_.ToString();
+    }
+    Object* Eval(Context& context) override {
+        return this;
+    }
+    const BigInteger& GetValue() const {
+        return value_;
+    }
+
+private:
+    BigInteger value_;
+};
+
+// Inexact real. Arithmetic with a Flonum operand yields a Flonum; within
+// one call intermediate results stay unboxed doubles.
+class Flonum : public Object {
+public:
+    static constexpr ObjectType kType = ObjectType::kFlonum;
+
+    explicit Flonum(double value) : Object(kType), value_(value) {
+    }
+    // Prints the shortest text that reads back as the same value.
+    void Print(std::ostream* out) override;
+    Object* Eval(Context& context) override {
+        return this;
+    }
+    double GetValue() const {
+        return value_;
+    }
+
+private:
+    double value_;
+};
+
 class Symbol : public Object {
 public:
-    Symbol(const std::string& name) : name_(name) {
+    static constexpr ObjectType kType = ObjectType::kSymbol;
+
+    Symbol(SymbolId id) : Object(kType), id_(id) {
     }
     void Print(std::ostream* out) override {
-        (*out) << name_;
+        (*out) << GetName();
     }
     Object* Eval(Context& context) override;
 
+    SymbolId GetId() const {
+        return id_;
+    }
+
     const std::string& GetName() const {
-        return name_;
+        return SymbolTable::Instance().GetName(id_);
+    }
+
+private:
+    SymbolId id_;
+};
+
+// Reference to a lambda parameter or internal define, resolved by the
+// analyzer to the frame depth and slot it lives in.
+class LocalVariable : public Object {
+public:
+    static constexpr ObjectType kType = ObjectType::kLocalVariable;
+
+    LocalVariable(SymbolId id, size_t depth, size_t slot)
+        : Object(kType), id_(id), depth_(depth), slot_(slot) {
+    }
+    void Print(std::ostream* out) override {
+        (*out) << SymbolTable::Instance().GetName(id_);
+    }
+    Object* Eval(Context& context) override;
+
+    SymbolId GetId() const {
+        return id_;
+    }
+
+    void Assign(Object* value, Context& context) {
+        context.SetSlot(depth_, slot_, value);
+    }
+
+    bool IsBound(Context& context) {
+        return context.GetSlot(depth_, slot_) != kUnboundSlot;
+    }
+
+    size_t GetDepth() const {
+        return depth_;
+    }
+
+    size_t GetSlot() const {
+        return slot_;
     }
 
 private:
-    std::string name_;
+    SymbolId id_;
+    size_t depth_;
+    size_t slot_;
 };
 
 struct List {
@@ -89,19 +235,75 @@ struct List {
     bool is_wrong = false;
 };
 
+// Evaluated arguments of a procedure call. Elements are read through the
+// owning vector, so the view survives that vector growing meanwhile.
+class Arguments {
+public:
+    Arguments(const std::vector<Object*>* values, size_t begin, size_t size)
+        : values_(values), begin_(begin), size_(size) {
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    Object* operator[](size_t index) const {
+        return (*values_)[begin_ + index];
+    }
+
+private:
+    const std::vector<Object*>* values_;
+    size_t begin_;
+    size_t size_;
+};
+
+// Call form left in tail position by EvalTail/ApplyTail. The loop in
+// Cell::Eval continues with it instead of recursing, in the given frame of a
+// called lambda or, if there is none, in the caller's context.
+struct TailCall {
+    Object* form = nullptr;
+    std::shared_ptr<Context> frame;
+};
+
 class Function : public Object {
 public:
+    Function() : Object(ObjectType::kFunction) {
+    }
+
     virtual Object* Eval(Context& context) override;
 
     virtual void Print(std::ostream* out) override;
 
-    virtual Object* Eval(const List& list, Context& context) = 0;
+    // Called with the whole call form, head included. Procedures evaluate
+    // the operands and Apply, special forms override this or EvalTail.
+    virtual Object* Eval(const Arguments& args, Context& context);
+
+    // Same as Eval, but may leave the form in tail position unevaluated in
+    // *tail, in which case the return value is meaningless.
+    virtual Object* EvalTail(const Arguments& args, Context& context, TailCall* tail);
+
+    virtual Object* Apply(const Arguments& args, Context& context);
+
+    virtual Object* ApplyTail(const Arguments& args, Context& context, TailCall* tail);
+
+    virtual bool IsSpecialForm() const {
+        return false;
+    }
 
     virtual ~Function() = default;
+
+protected:
+    explicit Function(ObjectType type) : Object(type) {
+    }
 };
 
 class Cell : public Object {
 public:
+    static constexpr ObjectType kType = ObjectType::kCell;
+
+    Cell() : Object(kType) {
+    }
+
     void Print(std::ostream* out) override;
 
     Object* Eval(Context& context) override;
@@ -121,283 +323,708 @@ public:
         second_ = second;
     }
 
+    void Trace(Heap* heap) override {
+        heap->MarkObject(first_);
+        heap->MarkObject(second_);
+    }
+
 private:
-    Object* first_;
-    Object* second_;
+    Object* first_ = nullptr;
+    Object* second_ = nullptr;
+};
+
+// Fixed-size array of objects with constant-time indexing, one pointer per
+// element.
+class Vector : public Object {
+public:
+    static constexpr ObjectType kType = ObjectType::kVector;
+
+    explicit Vector(std::vector<Object*> elements) : Object(kType), elements_(std::move(elements)) {
+    }
+
+    void Print(std::ostream* out) override;
+
+    Object* Eval(Context& context) override {
+        return this;
+    }
+
+    size_t Size() const {
+        return elements_.size();
+    }
+
+    Object* Get(size_t index) const {
+        return elements_[index];
+    }
+
+    void Set(size_t index, Object* value) {
+        elements_[index] = value;
+    }
+
+    void Trace(Heap* heap) override {
+        for (auto element : elements_) {
+            heap->MarkObject(element);
+        }
+    }
+
+    size_t ExtraBytes() const override {
+        return elements_.capacity() * sizeof(Object*);
+    }
+
+private:
+    std::vector<Object*> elements_;
+};
+
+// Walks the elements of a list without collecting them. For an improper list
+// the final non-list cdr is visited last, and IsTail() is true there.
+class ListIterator {
+public:
+    explicit ListIterator(Cell* list) : cell_(list) {
+    }
+
+    bool AtEnd() const {
+        return cell_ == nullptr && tail_ == nullptr;
+    }
+
+    bool IsTail() const {
+        return tail_ != nullptr;
+    }
+
+    Object* operator*() const {
+        return tail_ != nullptr ? tail_ : cell_->GetFirst();
+    }
+
+    ListIterator& operator++() {
+        if (tail_ != nullptr) {
+            tail_ = nullptr;
+            return *this;
+        }
+        Object* next = cell_->GetSecond();
+        if (Is<Cell>(next)) {
+            cell_ = As<Cell>(next);
+        } else {
+            cell_ = nullptr;
+            tail_ = next;
+        }
+        return *this;
+    }
+
+private:
+    Cell* cell_;
+    Object* tail_ = nullptr;
 };
 
 class True : public Function {
 public:
-    True() = default;
+    static constexpr ObjectType kType = ObjectType::kTrue;
+
+    True() : Function(kType) {
+    }
     Object* Eval(Context& context) override {
         return this;
     }
     void Print(std::ostream* out) override {
         (*out) << "#t";
     }
-    Object* Eval(const List& list, Context& context) override;
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class False : public Function {
 public:
-    False() = default;
+    static constexpr ObjectType kType = ObjectType::kFalse;
+
+    False() : Function(kType) {
+    }
     Object* Eval(Context& context) override {
         return this;
     }
     void Print(std::ostream* out) override {
         (*out) << "#f";
     }
-    Object* Eval(const List& list, Context& context) override;
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class QuoteFunction : public Function {
 public:
     QuoteFunction() = default;
-    Object* Eval(const List& list, Context& context) override;
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class PNumberFunction : public Function {
 public:
     PNumberFunction() = default;
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class EqualFunction : public Function {
 public:
     EqualFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MonIncFunction : public Function {
 public:
     MonIncFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MonDecFunction : public Function {
 public:
     MonDecFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MonNonIncFunction : public Function {
 public:
     MonNonIncFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MonNonDecFunction : public Function {
 public:
     MonNonDecFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class PlusFunction : public Function {
 public:
     PlusFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MinusFunction : public Function {
 public:
     MinusFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MultiplyFunction : public Function {
 public:
     MultiplyFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class DivisionFunction : public Function {
 public:
     DivisionFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MaxFunction : public Function {
 public:
     MaxFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class MinFunction : public Function {
 public:
     MinFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class AbsFunction : public Function {
 public:
     AbsFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class PPairFunction : public Function {
 public:
     PPairFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class PNullFunction : public Function {
 public:
     PNullFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class PListFunction : public Function {
 public:
     PListFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class ConsFunction : public Function {
 public:
     ConsFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class CarFunction : public Function {
 public:
     CarFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class CdrFunction : public Function {
 public:
     CdrFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class ListFunction : public Function {
 public:
     ListFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class ListRefFunction : public Function {
 public:
     ListRefFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class ListTailFunction : public Function {
 public:
     ListTailFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class LengthFunction : public Function {
+public:
+    LengthFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class AppendFunction : public Function {
+public:
+    AppendFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class ReverseFunction : public Function {
+public:
+    ReverseFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class LastPairFunction : public Function {
+public:
+    LastPairFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class MemberFunction : public Function {
+public:
+    MemberFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class AssocFunction : public Function {
+public:
+    AssocFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class MapFunction : public Function {
+public:
+    MapFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class ForEachFunction : public Function {
+public:
+    ForEachFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class FilterFunction : public Function {
+public:
+    FilterFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class FoldLeftFunction : public Function {
+public:
+    FoldLeftFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+// Calls its first argument with the others, the last of which is a list
+// spread into separate arguments; the call stays in tail position.
+class ApplyFunction : public Function {
+public:
+    ApplyFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+
+    Object* ApplyTail(const Arguments& args, Context& context, TailCall* tail) override;
+};
+
+// (pmap f list) and (preduce op init list) split the list into contiguous
+// chunks evaluated on worker threads, each allocating from its own heap in
+// worker mode. f and op must not have side effects: assigning a variable
+// of the calling interpreter or mutating a vector raises RuntimeError
+// there. Results come back in order: what the workers allocated is copied,
+// objects of the calling interpreter are returned as they are, and
+// procedures created by a worker raise RuntimeError. Calls nested in a
+// worker run on its thread.
+// preduce folds each chunk with op, then folds init and the chunk results
+// left to right, so op must be associative.
+class PMapFunction : public Function {
+public:
+    PMapFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class PReduceFunction : public Function {
+public:
+    PReduceFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class PVectorFunction : public Function {
+public:
+    PVectorFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class MakeVectorFunction : public Function {
+public:
+    MakeVectorFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class VectorFunction : public Function {
+public:
+    VectorFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class VectorLengthFunction : public Function {
+public:
+    VectorLengthFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class VectorRefFunction : public Function {
+public:
+    VectorRefFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class VectorSetFunction : public Function {
+public:
+    VectorSetFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class PHashTableFunction : public Function {
+public:
+    PHashTableFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class MakeHashTableFunction : public Function {
+public:
+    MakeHashTableFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableRefFunction : public Function {
+public:
+    HashTableRefFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableRefDefaultFunction : public Function {
+public:
+    HashTableRefDefaultFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableSetFunction : public Function {
+public:
+    HashTableSetFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableDeleteFunction : public Function {
+public:
+    HashTableDeleteFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableContainsFunction : public Function {
+public:
+    HashTableContainsFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableCountFunction : public Function {
+public:
+    HashTableCountFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableKeysFunction : public Function {
+public:
+    HashTableKeysFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableValuesFunction : public Function {
+public:
+    HashTableValuesFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableToAlistFunction : public Function {
+public:
+    HashTableToAlistFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class HashTableWalkFunction : public Function {
+public:
+    HashTableWalkFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class PBooleanFunction : public Function {
 public:
     PBooleanFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class NotFuntion : public Function {
 public:
     NotFuntion() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
 };
 
 class AndFunction : public Function {
 public:
     AndFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* EvalTail(const Arguments& args, Context& context, TailCall* tail) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class OrFunction : public Function {
 public:
     OrFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* EvalTail(const Arguments& args, Context& context, TailCall* tail) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class IfFunction : public Function {
 public:
     IfFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* EvalTail(const Arguments& args, Context& context, TailCall* tail) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class LambdaBuilderFunction : public Function {
 public:
-    LambdaBuilderFunction() = default;
+    static constexpr ObjectType kType = ObjectType::kLambdaBuilder;
+
+    LambdaBuilderFunction() : Function(kType) {
+    }
+
+    // Frame size computed by the analyzer: parameters plus internal defines.
+    explicit LambdaBuilderFunction(size_t frame_size) : Function(kType), frame_size_(frame_size) {
+    }
+
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
+
+    size_t GetFrameSize() const {
+        return frame_size_;
+    }
 
-    Object* Eval(const List& list, Context& context) override;
+private:
+    size_t frame_size_ = 0;
 };
 
 class LambdaFunction : public Function {
 public:
-    LambdaFunction() = default;
+    static constexpr ObjectType kType = ObjectType::kLambda;
+
+    LambdaFunction() : Function(kType) {
+    }
+
+    Object* Apply(const Arguments& args, Context& context) override;
+
+    Object* ApplyTail(const Arguments& args, Context& context, TailCall* tail) override;
+
+    void Trace(Heap* heap) override;
+
+    // Binds the arguments in a fresh frame from the caller's heap and
+    // returns it; the caller runs the body in it and releases it afterwards.
+    std::shared_ptr<Context> BindArguments(const Arguments& args, Heap* heap);
+
+    // Copy of this lambda closed over the given context; used by the VM to
+    // instantiate the template built at compile time.
+    LambdaFunction* Clone(Context& context);
+
+    const std::vector<Object*>& GetBody() const {
+        return functions_;
+    }
 
-    Object* Eval(const List& list, Context& context) override;
+    CompiledCode* GetCode() const {
+        return code_;
+    }
+
+    void SetCode(CompiledCode* code) {
+        code_ = code;
+    }
 
 private:
-    std::vector<std::string> args_;
+    size_t arity_ = 0;
+    size_t frame_size_ = 0;
+    // The context the lambda was created in; each call's frame links to it.
     std::shared_ptr<Context> context_;
     std::vector<Object*> functions_;
+    CompiledCode* code_ = nullptr;
 
 private:
     friend class LambdaBuilderFunction;
-    friend class DefineFunction;
+    friend class ImageWriter;
+    friend class ImageReader;
 };
 
 class DefineFunction : public Function {
 public:
     DefineFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class SetFunction : public Function {
 public:
     SetFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class SetCdrFunction : public Function {
 public:
     SetCdrFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class SetCarFunction : public Function {
 public:
     SetCarFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Eval(const Arguments& args, Context& context) override;
+
+    bool IsSpecialForm() const override {
+        return true;
+    }
 };
 
 class PSymbolFunction : public Function {
 public:
     PSymbolFunction() = default;
 
-    Object* Eval(const List& list, Context& context) override;
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class EqFunction : public Function {
+public:
+    EqFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
+};
+
+class StructuralEqualFunction : public Function {
+public:
+    StructuralEqualFunction() = default;
+
+    Object* Apply(const Arguments& args, Context& context) override;
 };
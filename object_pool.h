@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Slab allocator for a single object type. Objects live in fixed-size
+// chunks and are addressed by a dense slot id; fresh slots are handed out
+// by bumping next_, swept ones are recycled through a per-type free list.
+// T only has to be complete where the member functions are instantiated.
+template <typename T>
+class ObjectPool {
+public:
+    static constexpr size_t kChunkShift = 8;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkShift;
+
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() {
+        for (size_t id = 0; id < next_; ++id) {
+            if (live_[id]) {
+                Get(id)->~T();
+            }
+        }
+        for (auto chunk : chunks_) {
+            ::operator delete(chunk);
+        }
+    }
+
+    template <typename... Args>
+    T* Allocate(Args&&... args) {
+        size_t id;
+        if (!free_.empty()) {
+            id = free_.back();
+            free_.pop_back();
+        } else {
+            if (next_ == chunks_.size() * kChunkSize) {
+                chunks_.push_back(::operator new(kChunkSize * sizeof(T)));
+                sorted_chunks_.insert(std::upper_bound(sorted_chunks_.begin(), sorted_chunks_.end(),
+                                                       chunks_.back(), std::less<>()),
+                                      chunks_.back());
+                live_.resize(chunks_.size() * kChunkSize, false);
+            }
+            id = next_++;
+        }
+        T* res;
+        try {
+            res = new (Place(id)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            free_.push_back(id);
+            throw;
+        }
+        live_[id] = true;
+        ++size_;
+        return res;
+    }
+
+    // Destroys every live object for which is_garbage returns true and
+    // returns the number of destroyed objects. Slots are walked backwards so
+    // that the free list hands out low addresses first.
+    template <typename Predicate>
+    size_t Sweep(Predicate is_garbage) {
+        size_t freed = 0;
+        for (size_t id = next_; id-- > 0;) {
+            if (!live_[id] || !is_garbage(Get(id))) {
+                continue;
+            }
+            Get(id)->~T();
+            live_[id] = false;
+            free_.push_back(id);
+            ++freed;
+        }
+        size_ -= freed;
+        return freed;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    size_t Capacity() const {
+        return chunks_.size() * kChunkSize;
+    }
+
+    // Whether ptr points into one of this pool's chunks.
+    bool Contains(const void* ptr) const {
+        auto it = std::upper_bound(sorted_chunks_.begin(), sorted_chunks_.end(), ptr, std::less<>());
+        if (it == sorted_chunks_.begin()) {
+            return false;
+        }
+        auto begin = static_cast<const char*>(*--it);
+        return std::less_equal<>()(begin, static_cast<const char*>(ptr)) &&
+               std::less<>()(static_cast<const char*>(ptr), begin + kChunkSize * sizeof(T));
+    }
+
+private:
+    void* Place(size_t id) const {
+        return static_cast<char*>(chunks_[id >> kChunkShift]) + (id & (kChunkSize - 1)) * sizeof(T);
+    }
+
+    T* Get(size_t id) const {
+        return std::launder(static_cast<T*>(Place(id)));
+    }
+
+private:
+    std::vector<void*> chunks_;
+    // Chunks ordered by address, for Contains.
+    std::vector<const void*> sorted_chunks_;
+    std::vector<bool> live_;
+    std::vector<size_t> free_;
+    size_t next_ = 0;
+    size_t size_ = 0;
+};
@@ -0,0 +1,59 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+size_t DefaultParallelism() {
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+std::atomic<size_t> parallelism{DefaultParallelism()};
+
+}  // namespace
+
+size_t GetParallelism() {
+    return parallelism.load(std::memory_order_relaxed);
+}
+
+void SetParallelism(size_t threads) {
+    parallelism.store(std::max<size_t>(threads, 1), std::memory_order_relaxed);
+}
+
+void ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    std::vector<std::exception_ptr> errors(count);
+    auto run = [&](size_t index) {
+        try {
+            task(index);
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (size_t i = 0; i + 1 < count; ++i) {
+        try {
+            threads.emplace_back(run, i);
+        } catch (const std::system_error&) {
+            // Out of threads; this one runs here instead.
+            run(i);
+        }
+    }
+    run(count - 1);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
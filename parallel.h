@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Number of threads pmap and preduce spread their work over, including the
+// calling one. Defaults to the hardware concurrency; benchmarks and tests
+// may lower it, and 1 keeps everything on the calling thread.
+size_t GetParallelism();
+void SetParallelism(size_t threads);
+
+// Runs task(0) .. task(count - 1), each on its own thread except the last,
+// which runs on the calling thread, and waits for all of them. If tasks
+// throw, the exception of the lowest index is rethrown once all finished.
+void ParallelFor(size_t count, const std::function<void(size_t)>& task);
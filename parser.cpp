@@ -1,105 +1,161 @@
 #include "parser.h"
 #include "context.h"
 #include <variant>
+#include <vector>
 
 namespace {
 
-ConstantToken* GetIfConstantToken(Token* token) {
+const ConstantToken* GetIfConstantToken(const TokenView* token) {
     return std::get_if<ConstantToken>(token);
 }
 
-BracketToken* GetIfBracketToken(Token* token) {
+const BracketToken* GetIfBracketToken(const TokenView* token) {
     return std::get_if<BracketToken>(token);
 }
 
-SymbolToken* GetIfSymbolToken(Token* token) {
-    return std::get_if<SymbolToken>(token);
+const SymbolView* GetIfSymbolToken(const TokenView* token) {
+    return std::get_if<SymbolView>(token);
 }
 
-QuoteToken* GetIfQuoteToken(Token* token) {
+const QuoteToken* GetIfQuoteToken(const TokenView* token) {
     return std::get_if<QuoteToken>(token);
 }
 
-DotToken* GetIfDotToken(Token* token) {
+const DotToken* GetIfDotToken(const TokenView* token) {
     return std::get_if<DotToken>(token);
 }
 
-template <typename T, typename... Args>
-Object* MakeShared(Context& context, Args... args) {
-    auto res = std::make_shared<T>(args...);
-    context.AddPtrToData(res);
-    return res.get();
+const BigConstantView* GetIfBigConstantToken(const TokenView* token) {
+    return std::get_if<BigConstantView>(token);
 }
 
-Object* ReadText(Tokenizer* tokenizer, Context& context);
+const VectorToken* GetIfVectorToken(const TokenView* token) {
+    return std::get_if<VectorToken>(token);
+}
 
-Object* ReadList(Tokenizer* tokenizer, Context& context) {
-    SyntaxAssert(!tokenizer->IsEnd());
-    Token token = tokenizer->GetToken();
-    if (auto ptr = GetIfBracketToken(&token); ptr != nullptr && *ptr == BracketToken::CLOSE) {
-        return nullptr;
-    }
-    std::shared_ptr<Cell> cell = std::make_shared<Cell>();
-    context.AddPtrToData(cell);
-    cell->SetFirst(ReadText(tokenizer, context));
-    SyntaxAssert(!tokenizer->IsEnd());
-    token = tokenizer->GetToken();
-    if (auto ptr = GetIfBracketToken(&token); ptr != nullptr && *ptr == BracketToken::CLOSE) {
-        return cell.get();
-    } else if (auto ptr = GetIfDotToken(&token); ptr != nullptr) {
-        tokenizer->Next();
-        SyntaxAssert(!tokenizer->IsEnd());
-        cell->SetSecond(ReadText(tokenizer, context));
-    } else {
-        cell->SetSecond(ReadList(tokenizer, context));
-    }
-    return cell.get();
+const FloatConstantToken* GetIfFloatConstantToken(const TokenView* token) {
+    return std::get_if<FloatConstantToken>(token);
 }
 
-Object* ReadText(Tokenizer* tokenizer, Context& context) {
-    SyntaxAssert(!tokenizer->IsEnd());
-    Token token = tokenizer->GetToken();
-    tokenizer->Next();
-    if (auto ptr = GetIfBracketToken(&token); ptr != nullptr) {
-        SyntaxAssert(*ptr != BracketToken::CLOSE);
-        auto res = ReadList(tokenizer, context);
-        SyntaxAssert(!tokenizer->IsEnd() && tokenizer->GetToken() == Token{BracketToken::CLOSE});
-        tokenizer->Next();
-        return res;
-    }
-    SyntaxAssert(!GetIfDotToken(&token));
-    if (auto ptr = GetIfQuoteToken(&token); ptr != nullptr) {
-        std::shared_ptr<Cell> cell = std::make_shared<Cell>();
-        context.AddPtrToData(cell);
-        std::shared_ptr<Symbol> qu = std::make_shared<Symbol>("quote");
-        context.AddPtrToData(qu);
-        cell->SetFirst(qu.get());
-        SyntaxAssert(!tokenizer->IsEnd());
-        auto res = ReadText(tokenizer, context);
-        std::shared_ptr<Cell> cell2 = std::make_shared<Cell>();
-        context.AddPtrToData(cell2);
-        cell2->SetFirst(res);
-        cell->SetSecond(cell2.get());
-        return cell.get();
-    }
-    if (auto ptr = GetIfConstantToken(&token); ptr != nullptr) {
-        auto res = std::make_shared<Number>(ptr->value);
-        context.AddPtrToData(res);
-        return res.get();
+// A list, vector or quotation the reader has opened but not finished yet.
+struct PendingForm {
+    enum Kind { kList, kVector, kQuote };
+
+    explicit PendingForm(Kind kind, Cell* head = nullptr) : kind(kind), head(head) {
     }
-    if (auto ptr = GetIfSymbolToken(&token); ptr != nullptr) {
-        auto res = std::make_shared<Symbol>(ptr->name);
-        context.AddPtrToData(res);
-        return res.get();
+
+    Kind kind;
+    Cell* head = nullptr;
+    Cell* last = nullptr;
+    // Elements of a vector read so far.
+    std::vector<Object*> elements;
+    // Set once a dot was read, and once the datum after it was stored.
+    bool dotted = false;
+    bool closed_tail = false;
+};
+
+// Reads one datum with an explicit stack of open forms, so that neither
+// nesting depth nor list length is limited by the C++ stack. Lists are
+// built front to back by appending to the last cell.
+Object* ReadText(Lexer* lexer, Context& context) {
+    Heap* heap = context.GetHeap();
+    std::vector<PendingForm> stack;
+    while (true) {
+        SyntaxAssert(!lexer->IsEnd());
+        // The lexer overwrites its current token on Next, keep a copy; a
+        // symbol copy is still a view of the source.
+        TokenView token = lexer->GetToken();
+        lexer->Next();
+        if (!stack.empty() && stack.back().closed_tail) {
+            SyntaxAssert(token == TokenView{BracketToken::CLOSE});
+        }
+
+        Object* value = nullptr;
+        if (auto ptr = GetIfBracketToken(&token); ptr != nullptr) {
+            if (*ptr == BracketToken::OPEN) {
+                stack.emplace_back(PendingForm::kList);
+                continue;
+            }
+            SyntaxAssert(!stack.empty() && stack.back().kind != PendingForm::kQuote);
+            SyntaxAssert(stack.back().dotted == stack.back().closed_tail);
+            if (stack.back().kind == PendingForm::kVector) {
+                value = heap->Make<Vector>(std::move(stack.back().elements));
+            } else {
+                value = stack.back().head;
+            }
+            stack.pop_back();
+        } else if (auto ptr = GetIfVectorToken(&token); ptr != nullptr) {
+            stack.emplace_back(PendingForm::kVector);
+            continue;
+        } else if (auto ptr = GetIfDotToken(&token); ptr != nullptr) {
+            SyntaxAssert(!stack.empty() && stack.back().kind == PendingForm::kList);
+            SyntaxAssert(stack.back().last != nullptr && !stack.back().dotted);
+            stack.back().dotted = true;
+            continue;
+        } else if (auto ptr = GetIfQuoteToken(&token); ptr != nullptr) {
+            Cell* cell = heap->Make<Cell>();
+            cell->SetFirst(heap->InternSymbol(SymbolTable::kQuote));
+            stack.emplace_back(PendingForm::kQuote, cell);
+            continue;
+        } else if (auto ptr = GetIfConstantToken(&token); ptr != nullptr) {
+            value = heap->MakeInteger(ptr->value);
+        } else if (auto ptr = GetIfBigConstantToken(&token); ptr != nullptr) {
+            value = heap->Make<BigNum>(BigInteger::FromDecimal(ptr->digits));
+        } else if (auto ptr = GetIfFloatConstantToken(&token); ptr != nullptr) {
+            value = heap->Make<Flonum>(ptr->value);
+        } else if (auto ptr = GetIfSymbolToken(&token); ptr != nullptr) {
+            value = heap->InternSymbol(SymbolTable::Instance().Intern(ptr->name));
+        } else {
+            SyntaxAssert(false);
+        }
+
+        // Hand the finished datum to the innermost open form; a quotation is
+        // finished by it in turn.
+        while (true) {
+            if (stack.empty()) {
+                return value;
+            }
+            PendingForm& top = stack.back();
+            if (top.kind == PendingForm::kQuote) {
+                Cell* quoted = heap->Make<Cell>();
+                quoted->SetFirst(value);
+                top.head->SetSecond(quoted);
+                value = top.head;
+                stack.pop_back();
+                continue;
+            }
+            if (top.kind == PendingForm::kVector) {
+                top.elements.push_back(value);
+            } else if (top.dotted) {
+                top.last->SetSecond(value);
+                top.closed_tail = true;
+            } else {
+                Cell* cell = heap->Make<Cell>();
+                cell->SetFirst(value);
+                if (top.last == nullptr) {
+                    top.head = cell;
+                } else {
+                    top.last->SetSecond(cell);
+                }
+                top.last = cell;
+            }
+            break;
+        }
     }
-    SyntaxAssert(false);
-    return nullptr;
 }
 
 }  // namespace
 
-Object* Read(Tokenizer* tokenizer, Context& context) {
-    auto res = ReadText(tokenizer, context);
-    SyntaxAssert(tokenizer->IsEnd());
+Object* ReadDatum(Lexer* lexer, Context& context) {
+    return ReadText(lexer, context);
+}
+
+Object* Read(Lexer* lexer, Context& context) {
+    auto res = ReadText(lexer, context);
+    SyntaxAssert(lexer->IsEnd());
     return res;
 }
+
+Object* Read(Tokenizer* tokenizer, Context& context) {
+    return Read(tokenizer->GetLexer(), context);
+}
@@ -5,4 +5,9 @@
 
 #include <memory>
 
+// Reads the next datum and leaves the lexer at the token after it.
+Object* ReadDatum(Lexer* lexer, Context& context);
+
+// Reads a datum that must make up the whole input.
+Object* Read(Lexer* lexer, Context& context);
 Object* Read(Tokenizer* tokenizer, Context& context);
\ No newline at end of file
@@ -1,69 +1,104 @@
 #include "scheme.h"
 #include "parser.h"
-#include "function_registry.h"
+#include "analyzer.h"
+#include "compiler.h"
+#include "mapped_file.h"
+#include "form_stream.h"
+#include "heap_image.h"
 
+#include <cerrno>
+#include <fstream>
 #include <string>
 #include <memory>
 #include <sstream>
+#include <system_error>
 
 namespace {
 
 Object *ParseRequest(const std::string &request, Context &context) {
-    std::istringstream ss(request);
-    Tokenizer tokenizer(&ss);
-    auto res = Read(&tokenizer, context);
-    SyntaxAssert(tokenizer.IsEnd());
-    return res;
+    Lexer lexer(request);
+    return Analyze(Read(&lexer, context), context);
 }
 
 }  // namespace
 
-Interpreter::Interpreter() : context_(new Context()) {
-    context_->SetData(&data_);
-    FunctionRegistry &registry = FunctionRegistry::Instance();
-    registry.RegisterFunction<PNumberFunction>("number?");
-    registry.RegisterFunction<EqualFunction>("=");
-    registry.RegisterFunction<MonIncFunction>("<");
-    registry.RegisterFunction<MonDecFunction>(">");
-    registry.RegisterFunction<MonNonIncFunction>(">=");
-    registry.RegisterFunction<MonNonDecFunction>("<=");
-    registry.RegisterFunction<PlusFunction>("+");
-    registry.RegisterFunction<MinusFunction>("-");
-    registry.RegisterFunction<MultiplyFunction>("*");
-    registry.RegisterFunction<DivisionFunction>("/");
-    registry.RegisterFunction<MaxFunction>("max");
-    registry.RegisterFunction<MinFunction>("min");
-    registry.RegisterFunction<AbsFunction>("abs");
-    registry.RegisterFunction<PPairFunction>("pair?");
-    registry.RegisterFunction<PNullFunction>("null?");
-    registry.RegisterFunction<PListFunction>("list?");
-    registry.RegisterFunction<ConsFunction>("cons");
-    registry.RegisterFunction<CarFunction>("car");
-    registry.RegisterFunction<CdrFunction>("cdr");
-    registry.RegisterFunction<ListFunction>("list");
-    registry.RegisterFunction<ListRefFunction>("list-ref");
-    registry.RegisterFunction<ListTailFunction>("list-tail");
-    registry.RegisterFunction<True>("#t");
-    registry.RegisterFunction<False>("#f");
-    registry.RegisterFunction<PBooleanFunction>("boolean?");
-    registry.RegisterFunction<NotFuntion>("not");
-    registry.RegisterFunction<AndFunction>("and");
-    registry.RegisterFunction<OrFunction>("or");
-    registry.RegisterFunction<QuoteFunction>("quote");
-    registry.RegisterFunction<IfFunction>("if");
-    registry.RegisterFunction<LambdaBuilderFunction>("lambda");
-    registry.RegisterFunction<DefineFunction>("define");
-    registry.RegisterFunction<SetFunction>("set!");
-    registry.RegisterFunction<SetCdrFunction>("set-cdr!");
-    registry.RegisterFunction<SetCarFunction>("set-car!");
-    registry.RegisterFunction<PSymbolFunction>("symbol?");
+Interpreter::Interpreter() : vm_(&heap_), form_cache_(&heap_), context_(new Context()) {
+    context_->SetHeap(&heap_);
+    heap_.AddRootContext(context_.get());
+}
+
+Interpreter::~Interpreter() {
+    heap_.RemoveRootContext(context_.get());
 }
 
 std::string Interpreter::Run(const std::string &request) {
-    Object *parsed_request = ParseRequest(request, *context_);
+    heap_.MaybeCollect();
+    CachedForm *cached = form_cache_.Find(request);
+    if (cached != nullptr) {
+        return Evaluate(cached->form, cached);
+    }
+    Object *form = ParseRequest(request, *context_);
+    return Evaluate(form, form_cache_.Insert(request, form));
+}
+
+void Interpreter::RunFile(const std::string &path, std::ostream *out) {
+    MappedFile file(path);
+    Lexer lexer(file.GetContents());
+    while (!lexer.IsEnd()) {
+        heap_.MaybeCollect();
+        (*out) << Evaluate(Analyze(ReadDatum(&lexer, *context_), *context_)) << '\n';
+    }
+}
+
+void Interpreter::RunStream(std::istream *in, std::ostream *out) {
+    if (stream_in_ != in) {
+        stream_forms_ = std::make_unique<FormStream>(in);
+        stream_in_ = in;
+    }
+    std::string_view form;
+    while (stream_forms_->Next(&form)) {
+        heap_.MaybeCollect();
+        Lexer lexer(form);
+        (*out) << Evaluate(Analyze(Read(&lexer, *context_), *context_)) << std::endl;
+    }
+    stream_forms_.reset();
+    stream_in_ = nullptr;
+}
+
+void Interpreter::SaveImage(const std::string &path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (out) {
+        ::SaveImage(*context_, &out);
+        out.flush();
+    }
+    if (!out) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+}
+
+void Interpreter::LoadImage(const std::string &path) {
+    MappedFile file(path);
+    ::LoadImage(file.GetContents(), *context_);
+}
+
+std::string Interpreter::Evaluate(Object *parsed_request, CachedForm *cached) {
     std::ostringstream ss;
     RuntimeAssert(parsed_request != nullptr);
-    auto res = parsed_request->Eval(*context_);
+    Heap::RootGuard guard(&heap_);
+    heap_.PushRoot(parsed_request);
+    Object *res;
+    if (mode_ == ExecutionMode::kBytecode) {
+        CompiledCode *code = cached != nullptr ? cached->code : nullptr;
+        if (code == nullptr) {
+            code = Compile(parsed_request, *context_);
+            if (cached != nullptr) {
+                cached->code = code;
+            }
+        }
+        res = vm_.Execute(code, *context_);
+    } else {
+        res = parsed_request->Eval(*context_);
+    }
     if (res) {
         res->Print(&ss);
     } else {
@@ -71,3 +106,31 @@ std::string Interpreter::Run(const std::string &request) {
     }
     return ss.str();
 }
+
+GcStats Interpreter::GetGcStats() const {
+    return heap_.GetStats();
+}
+
+void Interpreter::SetGcThreshold(size_t bytes) {
+    heap_.SetThreshold(bytes);
+}
+
+void Interpreter::CollectGarbage() {
+    heap_.Collect();
+}
+
+void Interpreter::SetFormCacheCapacity(size_t capacity) {
+    form_cache_.SetCapacity(capacity);
+}
+
+FormCacheStats Interpreter::GetFormCacheStats() const {
+    return form_cache_.GetStats();
+}
+
+void Interpreter::SetExecutionMode(ExecutionMode mode) {
+    mode_ = mode;
+}
+
+ExecutionMode Interpreter::GetExecutionMode() const {
+    return mode_;
+}
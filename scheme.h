@@ -2,14 +2,66 @@
 
 #include "scheme_fwd.h"
 #include "context.h"
+#include "heap.h"
+#include "vm.h"
+#include "form_cache.h"
+#include "form_stream.h"
+#include <istream>
+#include <ostream>
 #include <string>
 
+// Engine used by Interpreter::Run. Both produce the same results and errors;
+// the bytecode engine compiles each request before running it.
+enum class ExecutionMode {
+    kTreeWalk,
+    kBytecode,
+};
+
 class Interpreter {
 public:
     Interpreter();
+    ~Interpreter();
     std::string Run(const std::string& request);
 
+    // Evaluates every top-level form of a script, read in place from a
+    // memory mapping, and writes each result on its own line.
+    void RunFile(const std::string& path, std::ostream* out);
+
+    // Same for a stream such as a pipe: each form is evaluated as soon as it
+    // has arrived and its result is flushed, buffering one form at a time.
+    // Errors propagate; calling again with the same stream resumes after
+    // the form that failed, with the input already read kept.
+    void RunStream(std::istream* in, std::ostream* out);
+
+    // Writes the global environment and everything reachable from it to a
+    // heap image, and defines the contents of one in this interpreter.
+    // Throw std::system_error on I/O errors, RuntimeError on a bad image.
+    void SaveImage(const std::string& path);
+    void LoadImage(const std::string& path);
+
+    // Garbage collector controls.
+    GcStats GetGcStats() const;
+    void SetGcThreshold(size_t bytes);
+    void CollectGarbage();
+
+    // Parsed-form cache for Run; disabled until given a capacity.
+    void SetFormCacheCapacity(size_t capacity);
+    FormCacheStats GetFormCacheStats() const;
+
+    void SetExecutionMode(ExecutionMode mode);
+    ExecutionMode GetExecutionMode() const;
+
+private:
+    // Compiles through cached when it is given, and reuses its code.
+    std::string Evaluate(Object* parsed_request, CachedForm* cached = nullptr);
+
 private:
-    std::vector<std::shared_ptr<Object>> data_;
+    Heap heap_;
+    VirtualMachine vm_;
+    FormCache form_cache_;
     std::shared_ptr<Context> context_;
+    ExecutionMode mode_ = ExecutionMode::kTreeWalk;
+    // Reader of the stream RunStream last left unfinished.
+    std::istream* stream_in_ = nullptr;
+    std::unique_ptr<FormStream> stream_forms_;
 };
\ No newline at end of file
@@ -8,9 +8,15 @@ struct List;
 
 class FunctionRegistry;
 
+class Heap;
+
+class CompiledCode;
+class VirtualMachine;
+
 class Object;
 
 class Number;
+class Flonum;
 class Symbol;
 class Cell;
 
@@ -60,6 +66,45 @@ class CdrFunction;
 class ListFunction;
 class ListRefFunction;
 class ListTailFunction;
+class LengthFunction;
+class AppendFunction;
+class ReverseFunction;
+class LastPairFunction;
+class MemberFunction;
+class AssocFunction;
+
+// higher-order functions
+class MapFunction;
+class ForEachFunction;
+class FilterFunction;
+class FoldLeftFunction;
+class ApplyFunction;
+
+// parallel higher-order functions
+class PMapFunction;
+class PReduceFunction;
+
+// vector operations
+class PVectorFunction;
+class MakeVectorFunction;
+class VectorFunction;
+class VectorLengthFunction;
+class VectorRefFunction;
+class VectorSetFunction;
+
+// hash tables
+class PHashTableFunction;
+class MakeHashTableFunction;
+class HashTableRefFunction;
+class HashTableRefDefaultFunction;
+class HashTableSetFunction;
+class HashTableDeleteFunction;
+class HashTableContainsFunction;
+class HashTableCountFunction;
+class HashTableKeysFunction;
+class HashTableValuesFunction;
+class HashTableToAlistFunction;
+class HashTableWalkFunction;
 
 // boolean
 class True;
@@ -0,0 +1,47 @@
+#include "symbol_table.h"
+#include "error.h"
+
+#include <mutex>
+
+// static
+SymbolTable& SymbolTable::Instance() {
+    static SymbolTable singleton;
+    return singleton;
+}
+
+SymbolTable::SymbolTable() {
+    Intern("quote");
+    Intern("#t");
+    Intern("#f");
+    Intern("lambda");
+    Intern("define");
+    Intern("set!");
+    Intern("set-car!");
+    Intern("set-cdr!");
+    Intern("if");
+    Intern("and");
+    Intern("or");
+}
+
+SymbolId SymbolTable::Intern(std::string_view name) {
+    {
+        std::shared_lock lock(mutex_);
+        if (auto it = ids_.find(name); it != ids_.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock lock(mutex_);
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second;
+    }
+    SymbolId id = names_.size();
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+const std::string& SymbolTable::GetName(SymbolId id) const {
+    std::shared_lock lock(mutex_);
+    RuntimeAssert(id < names_.size());
+    return names_[id];
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using SymbolId = uint32_t;
+
+// Process-wide table interning symbol names to small dense ids.
+// Names are interned once at read time; afterwards symbols, environments
+// and the builtin registry only deal with ids.
+class SymbolTable {
+public:
+    // Ids reserved for names the evaluator itself has to recognize.
+    static constexpr SymbolId kQuote = 0;
+    static constexpr SymbolId kTrue = 1;
+    static constexpr SymbolId kFalse = 2;
+    static constexpr SymbolId kLambda = 3;
+    static constexpr SymbolId kDefine = 4;
+    static constexpr SymbolId kSet = 5;
+    static constexpr SymbolId kSetCar = 6;
+    static constexpr SymbolId kSetCdr = 7;
+    static constexpr SymbolId kIf = 8;
+    static constexpr SymbolId kAnd = 9;
+    static constexpr SymbolId kOr = 10;
+
+    static SymbolTable& Instance();
+
+    SymbolId Intern(std::string_view name);
+    const std::string& GetName(SymbolId id) const;
+
+private:
+    SymbolTable();
+
+private:
+    // Readers of existing names only take the lock shared.
+    mutable std::shared_mutex mutex_;
+    // Keys view the strings in names_, which a deque never moves.
+    std::unordered_map<std::string_view, SymbolId> ids_;
+    std::deque<std::string> names_;
+};
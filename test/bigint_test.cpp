@@ -0,0 +1,272 @@
+// BigInteger arithmetic: Karatsuba products against a schoolbook reference,
+// Knuth D quotients and remainders against the division identity, decimal
+// round trips, and the INT64_MIN edge cases of the integer tower in both
+// execution modes. Exits with status 1 and prints the failing cases on a
+// mismatch.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. bigint_test.cpp $(ls ../*.cpp) -o bigint_test
+
+#include "bigint.h"
+#include "error.h"
+#include "scheme.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+std::mt19937_64 random_engine(7);
+
+// Random magnitude of the given number of limbs; some limbs are all zeros
+// or all ones, which exercise carries and the quotient estimate.
+std::vector<uint32_t> RandomLimbs(size_t size) {
+    std::vector<uint32_t> limbs(size);
+    for (auto& limb : limbs) {
+        switch (random_engine() % 4) {
+            case 0:
+                limb = 0;
+                break;
+            case 1:
+                limb = UINT32_MAX;
+                break;
+            default:
+                limb = static_cast<uint32_t>(random_engine());
+                break;
+        }
+    }
+    if (size > 0 && limbs.back() == 0) {
+        limbs.back() = 1;
+    }
+    return limbs;
+}
+
+BigInteger RandomInteger(size_t size) {
+    return BigInteger::FromLimbs(random_engine() % 2, RandomLimbs(size));
+}
+
+// Plain O(n m) product, independent of the library's implementation.
+std::vector<uint32_t> ReferenceProduct(const std::vector<uint32_t>& lhs,
+                                       const std::vector<uint32_t>& rhs) {
+    std::vector<uint32_t> res(lhs.size() + rhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < rhs.size(); ++j) {
+            uint64_t current = uint64_t(lhs[i]) * rhs[j] + res[i + j] + carry;
+            res[i + j] = static_cast<uint32_t>(current);
+            carry = current >> 32;
+        }
+        res[i + rhs.size()] = static_cast<uint32_t>(carry);
+    }
+    while (!res.empty() && res.back() == 0) {
+        res.pop_back();
+    }
+    return res;
+}
+
+void CheckProduct(const BigInteger& lhs, const BigInteger& rhs) {
+    BigInteger product = lhs * rhs;
+    auto expected = BigInteger::FromLimbs(lhs.IsNegative() != rhs.IsNegative(),
+                                          ReferenceProduct(lhs.GetLimbs(), rhs.GetLimbs()));
+    Check(Compare(product, expected) == 0,
+          "product of " + std::to_string(lhs.GetLimbs().size()) + " by " +
+              std::to_string(rhs.GetLimbs().size()) + " limbs");
+}
+
+// Truncated division is the only q, r with lhs = q rhs + r, |r| < |rhs| and
+// r zero or of the sign of lhs.
+void CheckDivision(const BigInteger& lhs, const BigInteger& rhs) {
+    BigInteger quotient = lhs / rhs;
+    BigInteger remainder = lhs % rhs;
+    auto abs = [](const BigInteger& value) { return value.IsNegative() ? -value : value; };
+    bool ok = Compare(quotient * rhs + remainder, lhs) == 0 &&
+              Compare(abs(remainder), abs(rhs)) < 0 &&
+              (remainder.IsZero() || remainder.IsNegative() == lhs.IsNegative());
+    Check(ok, "division of " + lhs.ToString().substr(0, 40) + "... by " +
+                  rhs.ToString().substr(0, 40) + "...");
+}
+
+void TestKaratsuba() {
+    const size_t threshold = BigInteger::kKaratsubaThreshold;
+    const size_t sizes[] = {1, 2, threshold - 1, threshold, threshold + 1, 2 * threshold - 1,
+                            2 * threshold, 3 * threshold + 5, 200, 513};
+    for (size_t lhs : sizes) {
+        for (size_t rhs : sizes) {
+            CheckProduct(RandomInteger(lhs), RandomInteger(rhs));
+        }
+    }
+    // Every limb at its maximum carries through all partial sums.
+    for (size_t size : {threshold, 2 * threshold + 1, size_t(300)}) {
+        auto ones = BigInteger::FromLimbs(false, std::vector<uint32_t>(size, UINT32_MAX));
+        CheckProduct(ones, ones);
+        CheckProduct(ones, -ones);
+    }
+    // (10^400 - 1)^2 = 9...98 0...01, with 399 nines and 399 zeros.
+    BigInteger nines = BigInteger::FromDecimal(std::string(400, '9'));
+    Check((nines * nines).ToString() == std::string(399, '9') + "8" + std::string(399, '0') + "1",
+          "(10^400 - 1)^2");
+    Check((BigInteger(0) * nines).IsZero() && !(BigInteger(0) * -nines).IsNegative(),
+          "zero product");
+}
+
+void TestKnuthDivision() {
+    const size_t sizes[] = {1, 2, 3, 7, 32, 65, 200};
+    for (size_t lhs : sizes) {
+        for (size_t rhs : sizes) {
+            CheckDivision(RandomInteger(lhs), RandomInteger(rhs));
+            CheckDivision(RandomInteger(lhs + rhs), RandomInteger(rhs));
+        }
+    }
+    // Divisors whose top limb needs the largest and no normalization shift,
+    // and quotient estimates one and two too large, which take the
+    // correction and add-back steps.
+    std::vector<std::vector<uint32_t>> dividends = {
+        {0, 0, 0x80000000, 0x7FFFFFFF},
+        {0, 0xFFFFFFFE, 0x80000000},
+        {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF},
+        {3, 0, 0x80000000},
+        {0, 0, 0, 0, 1},
+    };
+    std::vector<std::vector<uint32_t>> divisors = {
+        {1, 0, 0x80000000},
+        {0xFFFFFFFF, 0x80000000},
+        {1, 1},
+        {0xFFFFFFFF, 0xFFFFFFFF},
+        {0, 1},
+        {0x12345678, 0x00000001},
+    };
+    for (auto& dividend : dividends) {
+        for (auto& divisor : divisors) {
+            for (bool negative : {false, true}) {
+                CheckDivision(BigInteger::FromLimbs(negative, dividend),
+                              BigInteger::FromLimbs(false, divisor));
+                CheckDivision(BigInteger::FromLimbs(false, dividend),
+                              BigInteger::FromLimbs(negative, divisor));
+            }
+        }
+    }
+    // Exact quotients of products.
+    for (size_t size : {size_t(3), size_t(40), size_t(150)}) {
+        BigInteger lhs = RandomInteger(size);
+        BigInteger rhs = RandomInteger(size / 2 + 1);
+        Check(Compare((lhs * rhs) / rhs, lhs) == 0 && ((lhs * rhs) % rhs).IsZero(),
+              "exact quotient of " + std::to_string(size) + " limbs");
+    }
+    bool threw = false;
+    try {
+        BigInteger(1) / BigInteger(0);
+    } catch (const RuntimeError&) {
+        threw = true;
+    }
+    Check(threw, "division by zero");
+}
+
+void TestDecimal() {
+    Check(BigInteger::FromLimbs(false, {0, 0, 1}).ToString() == "18446744073709551616", "2^64");
+    Check(BigInteger::FromLimbs(false, {0, 0, 0, 0, 1}).ToString() ==
+              "340282366920938463463374607431768211456",
+          "2^128");
+    BigInteger factorial(1);
+    for (int i = 2; i <= 30; ++i) {
+        factorial = factorial * BigInteger(i);
+    }
+    Check(factorial.ToString() == "265252859812191058636308480000000", "30!");
+    Check(BigInteger::FromDecimal("-000123").ToString() == "-123", "leading zeros");
+    Check(BigInteger::FromDecimal("-0").ToString() == "0", "negative zero");
+    for (size_t size : {size_t(1), size_t(5), size_t(64), size_t(400)}) {
+        BigInteger value = RandomInteger(size);
+        Check(Compare(BigInteger::FromDecimal(value.ToString()), value) == 0,
+              "decimal round trip of " + std::to_string(size) + " limbs");
+    }
+}
+
+void TestInt64Limits() {
+    BigInteger min(INT64_MIN);
+    BigInteger max(INT64_MAX);
+    Check(min.ToString() == "-9223372036854775808" && min.FitsInt64() && min.ToInt64() == INT64_MIN,
+          "INT64_MIN round trip");
+    Check(max.FitsInt64() && max.ToInt64() == INT64_MAX, "INT64_MAX round trip");
+    Check((-min).ToString() == "9223372036854775808" && !(-min).FitsInt64(), "-INT64_MIN");
+    Check(!(max + BigInteger(1)).FitsInt64() && (min - BigInteger(1)).ToString() ==
+                                                     "-9223372036854775809",
+          "one past the limits");
+    Check(Compare(max + BigInteger(1), -min) == 0, "INT64_MAX + 1");
+    Check((min / BigInteger(-1)).ToString() == "9223372036854775808", "INT64_MIN / -1");
+    Check((min % BigInteger(-1)).IsZero(), "INT64_MIN % -1");
+    Check((min * BigInteger(-1)).ToString() == "9223372036854775808", "INT64_MIN * -1");
+    Check(BigInteger::FromDecimal("-9223372036854775808").FitsInt64() &&
+              !BigInteger::FromDecimal("9223372036854775808").FitsInt64(),
+          "parsed limits");
+}
+
+struct Case {
+    std::string request;
+    std::string expected;
+};
+
+// Numbers past int64_t through the interpreter, which keeps results that
+// fit as plain integers.
+const std::vector<Case> kCases = {
+    {"(+ 9223372036854775807 1)", "9223372036854775808"},
+    {"(- -9223372036854775808 1)", "-9223372036854775809"},
+    {"(/ -9223372036854775808 -1)", "9223372036854775808"},
+    {"(* -9223372036854775808 -1)", "9223372036854775808"},
+    {"(abs -9223372036854775808)", "9223372036854775808"},
+    {"(- (+ 9223372036854775807 1) 1)", "9223372036854775807"},
+    {"(- 0 -9223372036854775808)", "9223372036854775808"},
+    {"-9223372036854775808", "-9223372036854775808"},
+    {"(= (- (+ 9223372036854775807 1) 1) 9223372036854775807)", "#t"},
+    {"(* 4294967296 4294967296)", "18446744073709551616"},
+    {"(/ 18446744073709551616 4294967296)", "4294967296"},
+    {"(< -9223372036854775809 -9223372036854775808 9223372036854775808)", "#t"},
+    {"(max 1 100000000000000000000 -5)", "100000000000000000000"},
+    {"(/ 1 0)", "RuntimeError"},
+};
+
+std::string RunCase(Interpreter* interpreter, const std::string& request) {
+    try {
+        return interpreter->Run(request);
+    } catch (const SyntaxError&) {
+        return "SyntaxError";
+    } catch (const RuntimeError&) {
+        return "RuntimeError";
+    } catch (const NameError&) {
+        return "NameError";
+    }
+}
+
+void TestInterpreter() {
+    for (auto mode : {ExecutionMode::kTreeWalk, ExecutionMode::kBytecode}) {
+        Interpreter interpreter;
+        interpreter.SetExecutionMode(mode);
+        for (auto& [request, expected] : kCases) {
+            std::string result = RunCase(&interpreter, request);
+            Check(result == expected, std::string(mode == ExecutionMode::kBytecode ? "bytecode" : "tree") +
+                                          ": " + request + " => " + result + ", expected " +
+                                          expected);
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    TestKaratsuba();
+    TestKnuthDivision();
+    TestDecimal();
+    TestInt64Limits();
+    TestInterpreter();
+    std::printf("%s\n", failures == 0 ? "ok" : "failed");
+    return failures == 0 ? 0 : 1;
+}
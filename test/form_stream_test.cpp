@@ -0,0 +1,105 @@
+// FormStream splits input into the same forms whatever chunks it arrives
+// in, including atoms that run up to the end of the input, and
+// Interpreter::RunStream resumes after a form that failed without losing
+// input already read. Exits with status 1 and prints the failing cases on
+// a mismatch.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. form_stream_test.cpp $(ls ../*.cpp) -o form_stream_test
+
+#include "error.h"
+#include "form_stream.h"
+#include "scheme.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Case {
+    std::string input;
+    std::vector<std::string> forms;
+};
+
+// Most inputs end with an atom and no trailing whitespace, which the last
+// chunk only settles once the input has ended.
+const std::vector<Case> kCases = {
+    {"(+ 1 2) 12", {"(+ 1 2)", " 12"}},
+    {"12", {"12"}},
+    {"abc", {"abc"}},
+    {"'x", {"'x"}},
+    {"1.5 -2e3", {"1.5", " -2e3"}},
+    {"(f 1) 3.", {"(f 1)", " 3", "."}},
+    {"7 #(1 2)", {"7", " #(1 2)"}},
+    {"(a\n b)  ", {"(a\n b)"}},
+    {"(a (b", {"(a (b"}},
+    {"12ab c", {"12", "ab", " c"}},
+};
+
+int failures = 0;
+
+std::vector<std::string> Split(const std::string& input, size_t chunk_size) {
+    std::istringstream in(input);
+    FormStream forms(&in, chunk_size);
+    std::vector<std::string> res;
+    std::string_view form;
+    while (forms.Next(&form)) {
+        res.emplace_back(form);
+    }
+    return res;
+}
+
+std::string Join(const std::vector<std::string>& forms) {
+    std::string res;
+    for (auto& form : forms) {
+        res += "[" + form + "]";
+    }
+    return res;
+}
+
+void TestChunks() {
+    for (auto& [input, expected] : kCases) {
+        for (size_t chunk_size = 1; chunk_size <= input.size() + 1; ++chunk_size) {
+            auto forms = Split(input, chunk_size);
+            if (forms != expected) {
+                std::printf("FAIL chunks of %zu: %s => %s, expected %s\n", chunk_size,
+                            input.c_str(), Join(forms).c_str(), Join(expected).c_str());
+                ++failures;
+            }
+        }
+    }
+}
+
+// All of the input is read in one chunk, so the failing form leaves the
+// rest of it buffered.
+void TestResume() {
+    std::string input = "(+ 1 2) (car '()) (+ 3 4) undefined-name (+ 5 6)";
+    Interpreter interpreter;
+    std::istringstream in(input);
+    std::ostringstream out;
+    int errors = 0;
+    while (true) {
+        try {
+            interpreter.RunStream(&in, &out);
+            break;
+        } catch (const RuntimeError&) {
+            ++errors;
+        } catch (const NameError&) {
+            ++errors;
+        }
+    }
+    if (errors != 2 || out.str() != "3\n7\n11\n") {
+        std::printf("FAIL resume: %d errors, output %s\n", errors, out.str().c_str());
+        ++failures;
+    }
+}
+
+}  // namespace
+
+int main() {
+    TestChunks();
+    TestResume();
+    std::printf("%s\n", failures == 0 ? "ok" : "failed");
+    return failures == 0 ? 0 : 1;
+}
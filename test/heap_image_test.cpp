@@ -0,0 +1,270 @@
+// Heap images: an environment saved by one interpreter and loaded into
+// another gives the same results, for every pair of execution modes, and
+// images with flipped bytes either load or fail with RuntimeError. Each
+// corrupt image is loaded and used in a child process, so that a crash is
+// reported as a failure of that image. A corrupt image may legitimately
+// hold code that never terminates or recurses past the native stack (see
+// heap_image.h), so children get a time limit and stack overflows are told
+// apart from other faults.
+// Exits with status 1 and prints the failing cases on a mismatch.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. heap_image_test.cpp $(ls ../*.cpp) -o heap_image_test
+
+#include "error.h"
+#include "scheme.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kCorruptImages = 300;
+
+struct Case {
+    std::string request;
+    std::string expected;
+};
+
+// Closures with captured and internal state, shared and cyclic data, and
+// every kind of number.
+const std::vector<std::string> kDefinitions = {
+    "(define (adder x) (lambda (y) (+ x y)))",
+    "(define add2 (adder 2))",
+    "(define (g n) (define (sq z) (* z z)) (define q 3) (+ (sq n) q))",
+    "(define counter ((lambda (c) (lambda () (set! c (+ c 1)) c)) 0))",
+    "(define (f n) (if (< n 1) 0 (+ n (f (- n 1)))))",
+    "(define (k a b) (and a (or #f b) (map (lambda (x) (* x a)) (list a b))))",
+    "(define shared (list 1 2.5 'a))",
+    "(define v (vector shared shared -0.0))",
+    "(define h (make-hash-table))",
+    "(hash-table-set! h '(1 2) 'x)",
+    "(hash-table-set! h 'self h)",
+    "(define big 123456789012345678901234567890)",
+};
+
+// Run before saving, so that the bytecode engine has compiled the bodies,
+// and after loading.
+const std::vector<Case> kCases = {
+    {"(add2 5)", "7"},
+    {"((adder 10) 5)", "15"},
+    {"(g 4)", "19"},
+    {"(counter)", "1"},
+    {"(f 10)", "55"},
+    {"(k 2 3)", "(4 6)"},
+    {"v", "#((1 2.5 a) (1 2.5 a) -0.0)"},
+    {"(eq? (vector-ref v 0) (vector-ref v 1))", "#t"},
+    {"(eq? (vector-ref v 0) shared)", "#t"},
+    {"(hash-table-ref h '(1 2))", "x"},
+    {"(eq? h (hash-table-ref h 'self))", "#t"},
+    {"(* big big)", "15241578753238836750495351562536198787501905199875019052100"},
+};
+
+// Requests for loaded corrupt images. The recursive f is left out of those
+// images, so that only corruption makes evaluation recurse deeply.
+const std::vector<std::string> kCorruptRequests = {
+    "(add2 5)", "((adder 2) 5)", "(g 4)", "(counter)", "(counter)", "(k 1 2)",
+    "(vector-ref v 1)", "(hash-table-ref/default h '(1 2) 0)", "big",
+};
+
+int failures = 0;
+
+const char* ModeName(ExecutionMode mode) {
+    return mode == ExecutionMode::kBytecode ? "bytecode" : "tree";
+}
+
+std::string RunCase(Interpreter* interpreter, const std::string& request) {
+    try {
+        return interpreter->Run(request);
+    } catch (const SyntaxError&) {
+        return "SyntaxError";
+    } catch (const RuntimeError&) {
+        return "RuntimeError";
+    } catch (const NameError&) {
+        return "NameError";
+    }
+}
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << contents;
+}
+
+void TestRoundTrip(ExecutionMode save_mode, ExecutionMode load_mode, const std::string& path) {
+    {
+        Interpreter source;
+        source.SetExecutionMode(save_mode);
+        for (auto& definition : kDefinitions) {
+            source.Run(definition);
+        }
+        for (auto& [request, expected] : kCases) {
+            RunCase(&source, request);
+        }
+        source.SaveImage(path);
+    }
+    Interpreter target;
+    target.SetExecutionMode(load_mode);
+    target.LoadImage(path);
+    target.CollectGarbage();
+    for (auto& [request, expected] : kCases) {
+        // The counter was called once before saving.
+        std::string want = request == "(counter)" ? "2" : expected;
+        std::string result = RunCase(&target, request);
+        if (result != want) {
+            std::printf("FAIL %s to %s: %s => %s, expected %s\n", ModeName(save_mode),
+                        ModeName(load_mode), request.c_str(), result.c_str(), want.c_str());
+            ++failures;
+        }
+    }
+}
+
+constexpr int kLoadedStatus = 0;
+constexpr int kRejectedStatus = 10;
+constexpr int kStackOverflowStatus = 20;
+
+char* child_stack_top = nullptr;
+
+// A fault within the stack size limit below the child's entry point is a
+// stack overflow; anything else gets the default action.
+void OnSegmentationFault(int, siginfo_t* info, void*) {
+    rlimit limit;
+    getrlimit(RLIMIT_STACK, &limit);
+    size_t size = std::min<rlim_t>(limit.rlim_cur, rlim_t(1) << 30) + (1 << 20);
+    char* address = static_cast<char*>(info->si_addr);
+    if (address < child_stack_top && address + size > child_stack_top) {
+        _exit(kStackOverflowStatus);
+    }
+    signal(SIGSEGV, SIG_DFL);
+}
+
+void CatchStackOverflow() {
+    char top;
+    child_stack_top = &top;
+    stack_t alternate{};
+    alternate.ss_size = 1 << 16;
+    alternate.ss_sp = std::malloc(alternate.ss_size);
+    sigaltstack(&alternate, nullptr);
+    struct sigaction action{};
+    action.sa_sigaction = OnSegmentationFault;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigaction(SIGSEGV, &action, nullptr);
+}
+
+// Child process body: exits with kLoadedStatus if the image loaded,
+// kRejectedStatus if it was rejected with RuntimeError, and 1 on any other
+// exception.
+[[noreturn]] void UseCorruptImage(ExecutionMode mode, const std::string& path) {
+    CatchStackOverflow();
+    alarm(5);
+    try {
+        Interpreter interpreter;
+        interpreter.SetExecutionMode(mode);
+        try {
+            interpreter.LoadImage(path);
+        } catch (const RuntimeError&) {
+            _exit(kRejectedStatus);
+        }
+        for (int round = 0; round < 2; ++round) {
+            interpreter.CollectGarbage();
+            for (auto& request : kCorruptRequests) {
+                RunCase(&interpreter, request);
+            }
+        }
+    } catch (...) {
+        _exit(1);
+    }
+    _exit(kLoadedStatus);
+}
+
+void TestCorruptImages(ExecutionMode mode, const std::string& path) {
+    {
+        Interpreter source;
+        source.SetExecutionMode(mode);
+        for (auto& definition : kDefinitions) {
+            if (definition.find("(f n)") == std::string::npos) {
+                source.Run(definition);
+            }
+        }
+        for (auto& request : kCorruptRequests) {
+            RunCase(&source, request);
+        }
+        source.SaveImage(path);
+    }
+    std::string image = ReadFile(path);
+    std::string corrupt_path = path + ".corrupt";
+    std::mt19937 random_engine(mode == ExecutionMode::kBytecode ? 2 : 1);
+    int loaded = 0;
+    int rejected = 0;
+    int timed_out = 0;
+    int overflowed = 0;
+    for (int run = 0; run < kCorruptImages; ++run) {
+        std::string corrupt = image;
+        for (int flips = 1 + random_engine() % 3; flips > 0; --flips) {
+            size_t pos = random_engine() % corrupt.size();
+            if (random_engine() % 2) {
+                corrupt[pos] ^= 1 << (random_engine() % 8);
+            } else {
+                corrupt[pos] = static_cast<char>(random_engine());
+            }
+        }
+        WriteFile(corrupt_path, corrupt);
+        std::fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            UseCorruptImage(mode, corrupt_path);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+            ++timed_out;
+        } else if (WIFEXITED(status) && WEXITSTATUS(status) == kLoadedStatus) {
+            ++loaded;
+        } else if (WIFEXITED(status) && WEXITSTATUS(status) == kRejectedStatus) {
+            ++rejected;
+        } else if (WIFEXITED(status) && WEXITSTATUS(status) == kStackOverflowStatus) {
+            ++overflowed;
+        } else {
+            std::printf("FAIL %s: corrupt image %d, status %d\n", ModeName(mode), run, status);
+            WriteFile(path + ".failed" + std::to_string(run), corrupt);
+            ++failures;
+        }
+    }
+    std::printf("%s: %d corrupt images loaded, %d rejected, %d timed out, %d overflowed the stack\n",
+                ModeName(mode), loaded, rejected, timed_out, overflowed);
+    std::filesystem::remove(corrupt_path);
+}
+
+}  // namespace
+
+int main() {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("heap_image_test_" + std::to_string(getpid()) + ".img"))
+                           .string();
+    for (auto save_mode : {ExecutionMode::kTreeWalk, ExecutionMode::kBytecode}) {
+        for (auto load_mode : {ExecutionMode::kTreeWalk, ExecutionMode::kBytecode}) {
+            TestRoundTrip(save_mode, load_mode, path);
+        }
+    }
+    for (auto mode : {ExecutionMode::kTreeWalk, ExecutionMode::kBytecode}) {
+        TestCorruptImages(mode, path);
+    }
+    std::filesystem::remove(path);
+    std::printf("%s\n", failures == 0 ? "ok" : "failed");
+    return failures == 0 ? 0 : 1;
+}
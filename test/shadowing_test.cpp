@@ -0,0 +1,116 @@
+// User bindings of library builtin names: global defines and lambda
+// bindings shadow the builtin in both execution modes, core builtins do
+// not. Exits with status 1 and prints the failing cases on a mismatch.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. shadowing_test.cpp $(ls ../*.cpp) -o shadowing_test
+
+#include "error.h"
+#include "scheme.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Case {
+    std::string request;
+    std::string expected;
+};
+
+// Each group runs in a fresh interpreter, so its defines do not leak.
+const std::vector<std::vector<Case>> kGroups = {
+    {
+        {"(length '(1 2))", "2"},
+        {"(define (length l) 42)", "()"},
+        {"(length '(1 2))", "42"},
+        {"(define (g l) (length l))", "()"},
+        {"(g '(1 2 3))", "42"},
+    },
+    {
+        {"(define (count l) (length l))", "()"},
+        {"(count '(1 2 3))", "3"},
+        {"(define (length l) 'mine)", "()"},
+        {"(count '(1 2 3))", "mine"},
+    },
+    {
+        {"(define (f reverse) (reverse 1))", "()"},
+        {"(f (lambda (x) (+ x 1)))", "2"},
+        {"(reverse '(1 2))", "(2 1)"},
+        {"(define (h l) (define (member x l) 'inner) (member 1 l))", "()"},
+        {"(h '(1))", "inner"},
+        {"(member 1 '(0 1))", "(1)"},
+    },
+    {
+        {"(define equal? 5)", "()"},
+        {"equal?", "5"},
+        {"(eq? 'a 'a)", "#t"},
+    },
+    {
+        {"(define (f map) (map 1))", "()"},
+        {"(f (lambda (x) (+ x 1)))", "2"},
+        {"(define (g apply filter) (apply filter))", "()"},
+        {"(g (lambda (x) x) 7)", "7"},
+        {"(map (lambda (x) (* x x)) '(1 2))", "(1 4)"},
+        {"(define (map l f) (if (null? l) '() (cons (f (car l)) (map (cdr l) f))))", "()"},
+        {"(map '(1 2) (lambda (x) (+ x 1)))", "(2 3)"},
+        {"(for-each (lambda (x) x) '(1))", "()"},
+    },
+    {
+        {"(define (first vector) (car vector))", "()"},
+        {"(first '(1 2))", "1"},
+        {"(define (vector-ref v i) 'mine)", "()"},
+        {"(vector-ref (vector 1 2) 0)", "mine"},
+    },
+    {
+        {"(define (pmap f l) 'serial)", "()"},
+        {"(pmap car '((1)))", "serial"},
+        {"(define (g preduce) (preduce))", "()"},
+        {"(g (lambda () 3))", "3"},
+    },
+    {
+        {"(define (hash-table-ref table key) 'mine)", "()"},
+        {"(hash-table-ref (make-hash-table) 1)", "mine"},
+        {"(define (g hash-table-count) (hash-table-count))", "()"},
+        {"(g (lambda () 4))", "4"},
+    },
+    {
+        {"(define (car x) 1)", "()"},
+        {"(car '(5))", "5"},
+    },
+};
+
+std::string RunCase(Interpreter* interpreter, const std::string& request) {
+    try {
+        return interpreter->Run(request);
+    } catch (const SyntaxError&) {
+        return "SyntaxError";
+    } catch (const RuntimeError&) {
+        return "RuntimeError";
+    } catch (const NameError&) {
+        return "NameError";
+    }
+}
+
+}  // namespace
+
+int main() {
+    int failures = 0;
+    for (auto mode : {ExecutionMode::kTreeWalk, ExecutionMode::kBytecode}) {
+        for (auto& group : kGroups) {
+            Interpreter interpreter;
+            interpreter.SetExecutionMode(mode);
+            for (auto& [request, expected] : group) {
+                std::string result = RunCase(&interpreter, request);
+                if (result != expected) {
+                    std::printf("FAIL %s: %s => %s, expected %s\n",
+                                mode == ExecutionMode::kBytecode ? "bytecode" : "tree",
+                                request.c_str(), result.c_str(), expected.c_str());
+                    ++failures;
+                }
+            }
+        }
+    }
+    std::printf("%s\n", failures == 0 ? "ok" : "failed");
+    return failures == 0 ? 0 : 1;
+}
@@ -1,23 +1,12 @@
 #include "tokenizer.h"
+#include "char_scan.h"
 #include "error.h"
 
-#include <cctype>
-#include <unordered_set>
-
-namespace {
-
-bool IsSymbol(char c) {
-    // < = >*#0-9?!-
-    static std::unordered_set<char> symbols = {'<', '=', '>', '*', '/', '#', '?', '!', '-', '+'};
-    return isalnum(c) || symbols.count(c);
-}
-
-bool IsInSyntax(char c) {
-    static std::unordered_set<char> other_symbols = {'.', '\'', '(', ')'};
-    return other_symbols.count(c) || IsSymbol(c) || std::isspace(c);
-}
-
-}  // namespace
+#include <charconv>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <type_traits>
 
 bool QuoteToken::operator==(const QuoteToken&) const {
     return true;
@@ -27,26 +16,40 @@ bool SymbolToken::operator==(const SymbolToken& other) const {
     return name == other.name;
 }
 
+bool SymbolView::operator==(const SymbolView& other) const {
+    return name == other.name;
+}
+
 bool DotToken::operator==(const DotToken&) const {
     return true;
 }
 
+bool VectorToken::operator==(const VectorToken&) const {
+    return true;
+}
+
 bool ConstantToken::operator==(const ConstantToken& other) const {
     return value == other.value;
 }
 
-Tokenizer::Tokenizer(std::istream* in) : in_(in) {
-    Next();
+bool BigConstantToken::operator==(const BigConstantToken& other) const {
+    return digits == other.digits;
 }
 
-bool Tokenizer::IsEnd() {
-    return is_end_;
+bool BigConstantView::operator==(const BigConstantView& other) const {
+    return digits == other.digits;
 }
 
-void Tokenizer::Next() {
-    while (!IsNowEnd() && std::isspace(Peek())) {
-        Get();
-    }
+bool FloatConstantToken::operator==(const FloatConstantToken& other) const {
+    return value == other.value;
+}
+
+Lexer::Lexer(std::string_view source) : source_(source) {
+    Next();
+}
+
+void Lexer::Next() {
+    pos_ = SkipSpaces(source_, pos_);
     if (IsNowEnd()) {
         is_end_ = true;
         return;
@@ -72,62 +75,105 @@ void Tokenizer::Next() {
         Get();
         return;
     }
+    if (c == '#' && pos_ + 1 < source_.size() && source_[pos_ + 1] == '(') {
+        current_token_ = VectorToken();
+        pos_ += 2;
+        return;
+    }
 
-    if (isdigit(c)) {
-        current_token_ = ConstantToken{GetNumber()};
+    size_t begin = pos_;
+    if (HasCharClass(c, kDigitChar)) {
+        current_token_ = GetNumber(begin);
         return;
     }
 
     if (c == '+' || c == '-') {
         Get();
-        int64_t x = GetNumber();
-        if (x == -1) {
-            current_token_ = SymbolToken{c + GetString()};
-        } else {
-            current_token_ = ConstantToken{c == '+' ? x : -x};
+        if (!IsNowEnd() && HasCharClass(Peek(), kDigitChar)) {
+            current_token_ = GetNumber(begin);
+            return;
         }
-        return;
     }
 
-    current_token_ = SymbolToken{GetString()};
+    current_token_ = SymbolView{GetString(begin)};
 }
 
-Token Tokenizer::GetToken() {
-    return *current_token_;
+// Reads the digits at the current position of the number that starts, maybe
+// with a sign, at begin; a fraction or an exponent after them makes it a
+// float.
+TokenView Lexer::GetNumber(size_t begin) {
+    size_t digits = pos_;
+    uint64_t value = 0;
+    pos_ = ParseDigits(source_, pos_, &value);
+    if (size_t end = SkipFraction(source_, pos_); end != pos_) {
+        return GetFloat(begin, end);
+    }
+    // Up to 19 significant digits the value has not wrapped yet.
+    while (digits + 1 < pos_ && source_[digits] == '0') {
+        ++digits;
+    }
+    bool negative = source_[begin] == '-';
+    uint64_t limit = negative ? uint64_t(1) << 63 : uint64_t(INT64_MAX);
+    if (pos_ - digits > 19 || value > limit) {
+        return BigConstantView{source_.substr(begin, pos_ - begin)};
+    }
+    return ConstantToken{static_cast<int64_t>(negative ? 0 - value : value)};
 }
 
-int64_t Tokenizer::GetNumber() {
-    if (IsNowEnd() || !std::isdigit(Peek())) {
-        return -1;
+// Converts the literal in [begin, end) and moves past it.
+FloatConstantToken Lexer::GetFloat(size_t begin, size_t end) {
+    pos_ = end;
+    // from_chars takes no plus sign.
+    if (source_[begin] == '+') {
+        ++begin;
     }
-    int64_t result = 0;
-    while (!IsNowEnd() && std::isdigit(Peek())) {
-        result = result * 10 + (Get() - '0');
+    double value;
+    auto [ptr, ec] = std::from_chars(source_.data() + begin, source_.data() + end, value);
+    if (ec == std::errc::result_out_of_range) {
+        // Unlike from_chars, strtod rounds to infinity or zero.
+        value = std::strtod(std::string(source_.substr(begin, end - begin)).c_str(), nullptr);
+    } else {
+        SyntaxAssert(ec == std::errc() && ptr == source_.data() + end);
     }
-    return result;
+    return FloatConstantToken{value};
 }
 
-std::string Tokenizer::GetString() {
-    std::string result;
-    while (!IsNowEnd()) {
-        SyntaxAssert(IsInSyntax(Peek()));
-        if (!IsSymbol(Peek())) {
-            break;
-        }
-        result.push_back(Get());
-    }
-    return result;
+// Extends the symbol that starts at begin as far as symbol characters go.
+std::string_view Lexer::GetString(size_t begin) {
+    pos_ = SkipSymbolChars(source_, pos_);
+    SyntaxAssert(IsNowEnd() || HasCharClass(Peek(), kSyntaxChar));
+    return source_.substr(begin, pos_ - begin);
 }
 
-bool Tokenizer::IsNowEnd() {
-    return in_->peek() == std::char_traits<char>::eof();
+char Lexer::Get() {
+    SyntaxAssert(HasCharClass(Peek(), kSyntaxChar));
+    return source_[pos_++];
 }
 
-char Tokenizer::Peek() {
-    return in_->peek();
+Tokenizer::Tokenizer(std::istream* in)
+    : buffer_(std::istreambuf_iterator<char>(*in), std::istreambuf_iterator<char>()),
+      lexer_(buffer_) {
+}
+
+bool Tokenizer::IsEnd() {
+    return lexer_.IsEnd();
 }
 
-char Tokenizer::Get() {
-    SyntaxAssert(IsInSyntax(Peek()));
-    return in_->get();
+void Tokenizer::Next() {
+    lexer_.Next();
+}
+
+Token Tokenizer::GetToken() {
+    return std::visit(
+        [](const auto& token) -> Token {
+            using T = std::decay_t<decltype(token)>;
+            if constexpr (std::is_same_v<T, SymbolView>) {
+                return SymbolToken{std::string(token.name)};
+            } else if constexpr (std::is_same_v<T, BigConstantView>) {
+                return BigConstantToken{std::string(token.digits)};
+            } else {
+                return token;
+            }
+        },
+        lexer_.GetToken());
 }
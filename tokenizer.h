@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <variant>
 #include <optional>
 #include <istream>
+#include <string>
+#include <string_view>
 
 struct SymbolToken {
     std::string name;
@@ -10,6 +13,13 @@ struct SymbolToken {
     bool operator==(const SymbolToken& other) const;
 };
 
+// Symbol token whose name refers into the lexed buffer.
+struct SymbolView {
+    std::string_view name;
+
+    bool operator==(const SymbolView& other) const;
+};
+
 struct QuoteToken {
     bool operator==(const QuoteToken&) const;
 };
@@ -20,33 +30,101 @@ struct DotToken {
 
 enum class BracketToken { OPEN, CLOSE };
 
+// The "#(" opening a vector literal, closed by an ordinary bracket.
+struct VectorToken {
+    bool operator==(const VectorToken&) const;
+};
+
 struct ConstantToken {
     int64_t value;
 
     bool operator==(const ConstantToken& other) const;
 };
 
-using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken>;
+// Integer literal outside the int64_t range, as its optionally signed digits.
+struct BigConstantToken {
+    std::string digits;
+
+    bool operator==(const BigConstantToken& other) const;
+};
+
+struct BigConstantView {
+    std::string_view digits;
+
+    bool operator==(const BigConstantView& other) const;
+};
+
+// Decimal literal with a fraction or an exponent, e.g. 1.5 or 2e-3.
+struct FloatConstantToken {
+    double value;
+
+    bool operator==(const FloatConstantToken& other) const;
+};
+
+using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken,
+                           BigConstantToken, FloatConstantToken, VectorToken>;
+
+using TokenView = std::variant<ConstantToken, BracketToken, SymbolView, QuoteToken, DotToken,
+                               BigConstantView, FloatConstantToken, VectorToken>;
+
+// Splits a contiguous buffer into tokens without copying it; symbol tokens
+// point into the buffer, which must outlive them.
+class Lexer {
+public:
+    explicit Lexer(std::string_view source);
 
+    bool IsEnd() const {
+        return is_end_;
+    }
+
+    void Next();
+
+    const TokenView& GetToken() const {
+        return current_token_;
+    }
+
+private:
+    TokenView GetNumber(size_t begin);
+    FloatConstantToken GetFloat(size_t begin, size_t end);
+    std::string_view GetString(size_t begin);
+    bool IsNowEnd() const {
+        return pos_ == source_.size();
+    }
+    char Peek() const {
+        return source_[pos_];
+    }
+    char Get();
+
+private:
+    std::string_view source_;
+    size_t pos_ = 0;
+    TokenView current_token_;
+    bool is_end_ = false;
+};
+
+// Compatibility interface for stream input. The stream is read into an owned
+// buffer up front and lexed from there; tokens are returned by value. Reading
+// up front means that on an interactive stream or a pipe the constructor
+// blocks until end of input; use FormStream to evaluate input as it arrives.
+// The lexer views the buffer, so a Tokenizer is neither copied nor moved.
 class Tokenizer {
 public:
     Tokenizer(std::istream* in);
 
+    Tokenizer(const Tokenizer&) = delete;
+    Tokenizer& operator=(const Tokenizer&) = delete;
+
     bool IsEnd();
 
     void Next();
 
     Token GetToken();
 
-private:
-    std::istream* in_;
-    std::optional<Token> current_token_;
-    bool is_end_ = false;
+    Lexer* GetLexer() {
+        return &lexer_;
+    }
 
 private:
-    int64_t GetNumber();
-    std::string GetString();
-    bool IsNowEnd();
-    char Peek();
-    char Get();
-};
\ No newline at end of file
+    std::string buffer_;
+    Lexer lexer_;
+};
@@ -0,0 +1,210 @@
+#include "vm.h"
+#include "compiler.h"
+#include "function_registry.h"
+
+VirtualMachine::VirtualMachine(Heap* heap) : heap_(heap) {
+    heap_->AddRootProvider(this);
+}
+
+VirtualMachine::~VirtualMachine() {
+    heap_->RemoveRootProvider(this);
+}
+
+void VirtualMachine::TraceRoots(Heap* heap) {
+    for (auto& frame : frames_) {
+        heap->MarkObject(frame.code);
+        heap->MarkContext(frame.context.get());
+    }
+}
+
+Object* VirtualMachine::Execute(CompiledCode* code, Context& context) {
+    auto& stack = heap_->GetStack();
+    size_t entry_depth = frames_.size();
+    size_t entry_size = stack.size();
+    frames_.push_back(Frame{code, 0, context.shared_from_this(), entry_size});
+    try {
+        return Run(entry_depth);
+    } catch (...) {
+        while (frames_.size() > entry_depth) {
+            PopFrame();
+        }
+        stack.resize(entry_size);
+        throw;
+    }
+}
+
+void VirtualMachine::PopFrame() {
+    if (frames_.back().owned) {
+        heap_->ReleaseFrame(std::move(frames_.back().context));
+    }
+    frames_.pop_back();
+}
+
+void VirtualMachine::CallLambda(LambdaFunction* lambda, size_t argc, bool tail) {
+    auto& stack = heap_->GetStack();
+    if (lambda->GetCode() == nullptr) {
+        lambda->SetCode(CompileBody(lambda->GetBody(), *frames_.back().context));
+    }
+    size_t callee = stack.size() - argc - 1;
+    auto context = lambda->BindArguments(Arguments(&stack, callee + 1, argc), heap_);
+    if (tail) {
+        Frame& frame = frames_.back();
+        stack.resize(frame.base);
+        if (frame.owned) {
+            heap_->ReleaseFrame(std::move(frame.context));
+        }
+        frame.code = lambda->GetCode();
+        frame.pc = 0;
+        frame.context = std::move(context);
+        frame.owned = true;
+    } else {
+        frames_.push_back(Frame{lambda->GetCode(), 0, std::move(context), callee, true});
+    }
+}
+
+Object* VirtualMachine::LoadGlobal(CompiledCode* code, uint32_t index, Context& context) {
+    auto& ref = code->GetGlobalRef(index);
+    SymbolId id = As<Symbol>(code->GetConstant(index))->GetId();
+    auto& registry = FunctionRegistry::Instance();
+    if (!registry.HasFunction(id) || registry.IsLibraryFunction(id)) {
+        if (Object** binding = context.FindGlobal(id)) {
+            ref.binding = binding;
+            return *binding;
+        }
+    }
+    ref.builtin = code->GetConstant(index)->Eval(context);
+    ref.globals = context.GetGlobalCount();
+    return ref.builtin;
+}
+
+Object* VirtualMachine::Run(size_t entry_depth) {
+    auto& stack = heap_->GetStack();
+    while (true) {
+        Frame& frame = frames_.back();
+        const Instruction& ins = frame.code->GetInstruction(frame.pc++);
+        switch (ins.op) {
+            case OpCode::kConstant:
+                stack.push_back(frame.code->GetConstant(ins.a));
+                break;
+            case OpCode::kLoadLocal: {
+                Object* value = frame.context->GetSlot(ins.a, ins.b);
+                NameAssert(value != kUnboundSlot);
+                stack.push_back(value);
+                break;
+            }
+            case OpCode::kLoadGlobal: {
+                auto& ref = frame.code->GetGlobalRef(ins.a);
+                if (ref.binding != nullptr) {
+                    stack.push_back(*ref.binding);
+                } else if (ref.builtin != nullptr && ref.globals == frame.context->GetGlobalCount()) {
+                    stack.push_back(ref.builtin);
+                } else {
+                    stack.push_back(LoadGlobal(frame.code, ins.a, *frame.context));
+                }
+                break;
+            }
+            case OpCode::kCheckLocal:
+                NameAssert(frame.context->GetSlot(ins.a, ins.b) != kUnboundSlot);
+                break;
+            case OpCode::kCheckGlobal:
+                NameAssert(frame.context->HasVariable(As<Symbol>(frame.code->GetConstant(ins.a))->GetId()));
+                break;
+            case OpCode::kStoreLocal:
+                frame.context->SetSlot(ins.a, ins.b, stack.back());
+                stack.back() = nullptr;
+                break;
+            case OpCode::kStoreGlobal:
+                frame.context->AddVariable(As<Symbol>(frame.code->GetConstant(ins.a))->GetId(), stack.back());
+                stack.back() = nullptr;
+                break;
+            case OpCode::kPop:
+                stack.pop_back();
+                break;
+            case OpCode::kJump:
+                frame.pc = ins.a;
+                break;
+            case OpCode::kJumpIfFalse: {
+                Object* value = stack.back();
+                stack.pop_back();
+                if (!ToBool(value)) {
+                    frame.pc = ins.a;
+                }
+                break;
+            }
+            case OpCode::kJumpIfFalseKeep:
+                if (!ToBool(stack.back())) {
+                    frame.pc = ins.a;
+                } else {
+                    stack.pop_back();
+                }
+                break;
+            case OpCode::kJumpIfTrueKeep:
+                if (ToBool(stack.back())) {
+                    frame.pc = ins.a;
+                } else {
+                    stack.pop_back();
+                }
+                break;
+            case OpCode::kMakeClosure:
+                stack.push_back(As<LambdaFunction>(frame.code->GetConstant(ins.a))->Clone(*frame.context));
+                break;
+            case OpCode::kCheckSpecial: {
+                Object* callee = stack.back();
+                // Most calls go to lambdas, which are never special forms.
+                if (Is<LambdaFunction>(callee)) {
+                    break;
+                }
+                RuntimeAssert(Is<Function>(callee));
+                if (!As<Function>(callee)->IsSpecialForm()) {
+                    break;
+                }
+                frame.pc = ins.b;
+                auto context = frame.context;
+                size_t begin = stack.size();
+                size_t size = PushList(As<Cell>(frame.code->GetConstant(ins.a)), heap_);
+                stack[begin] = callee;
+                Object* res = As<Function>(callee)->Eval(Arguments(&stack, begin, size), *context);
+                stack.resize(begin);
+                stack.back() = res;
+                break;
+            }
+            case OpCode::kCall:
+            case OpCode::kTailCall: {
+                bool tail = ins.op == OpCode::kTailCall;
+                size_t argc = ins.a;
+                heap_->MaybeCollect();
+                Object* callee = stack[stack.size() - argc - 1];
+                if (Is<LambdaFunction>(callee)) {
+                    CallLambda(As<LambdaFunction>(callee), argc, tail);
+                    break;
+                }
+                RuntimeAssert(Is<Function>(callee));
+                auto context = frame.context;
+                Object* res = As<Function>(callee)->Apply(Arguments(&stack, stack.size() - argc, argc), *context);
+                stack.resize(stack.size() - argc - 1);
+                stack.push_back(res);
+                if (!tail) {
+                    break;
+                }
+                [[fallthrough]];
+            }
+            case OpCode::kReturn: {
+                Object* res = stack.back();
+                stack.resize(frames_.back().base);
+                PopFrame();
+                if (frames_.size() == entry_depth) {
+                    return res;
+                }
+                stack.push_back(res);
+                break;
+            }
+            case OpCode::kEvalTree: {
+                Object* form = frame.code->GetConstant(ins.a);
+                RuntimeAssert(form != nullptr);
+                auto context = frame.context;
+                stack.push_back(form->Eval(*context));
+                break;
+            }
+        }
+    }
+}
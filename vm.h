@@ -0,0 +1,44 @@
+#pragma once
+
+#include "bytecode.h"
+
+#include <memory>
+#include <vector>
+
+// Stack-based interpreter for CompiledCode. Operands live on the heap's
+// evaluator stack, so they are GC roots without extra bookkeeping; calls to
+// lambdas push a VM frame instead of recursing in C++, and tail calls reuse
+// the current one.
+class VirtualMachine : public RootProvider {
+public:
+    explicit VirtualMachine(Heap* heap);
+    VirtualMachine(const VirtualMachine&) = delete;
+    VirtualMachine& operator=(const VirtualMachine&) = delete;
+    ~VirtualMachine();
+
+    Object* Execute(CompiledCode* code, Context& context);
+
+    void TraceRoots(Heap* heap) override;
+
+private:
+    struct Frame {
+        CompiledCode* code;
+        size_t pc;
+        std::shared_ptr<Context> context;
+        // Stack size to restore on return.
+        size_t base;
+        // Whether context is a call frame to hand back to the heap's pool.
+        bool owned = false;
+    };
+
+    void PopFrame();
+
+    Object* Run(size_t entry_depth);
+    // Slow path of kLoadGlobal, which resolves the symbol and caches it.
+    Object* LoadGlobal(CompiledCode* code, uint32_t index, Context& context);
+    void CallLambda(LambdaFunction* lambda, size_t argc, bool tail);
+
+private:
+    Heap* heap_;
+    std::vector<Frame> frames_;
+};